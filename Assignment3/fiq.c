@@ -0,0 +1,96 @@
+// The functions in this file set up the FIQ fast path. The interrupt
+// controller can route one interrupt source to the FIQ instead of the IRQ,
+// and this is used for the source that is most sensitive to timing: System
+// Timer compare 3, ticking at a fixed period. The FIQ is not held up by
+// the IRQ dispatcher, since the IRQ stub unmasks FIQs while it runs the C
+// handlers, and the FIQ handler in startV2.s only saves the registers it
+// uses. The handler counts the ticks, and keeps the largest delay between
+// the timer match and the handler, which fiq_report() writes to the console.
+
+// Header files
+#include "uart.h"
+#include "sysreg.h"
+#include "irq.h"
+#include "systimer.h"
+#include "fiq.h"
+
+// FIQ tick global variables, read and written by the FIQ handler
+volatile unsigned int fiqPeriod;
+volatile unsigned long fiqTicks;
+volatile unsigned int fiqLateMax;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       fiq_start
+//
+//  Arguments:      period:     The time between ticks, in microseconds
+//
+//  Returns:        void
+//
+//  Description:    This function routes System Timer compare 3 to the FIQ,
+//                  arms the first tick, and unmasks FIQ exceptions.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void fiq_start(unsigned int period)
+{
+    fiqPeriod = period;
+    fiqTicks = 0;
+    fiqLateMax = 0;
+
+    *SYSTEM_TIMER_CS = 0x1 << SYSTEM_TIMER_IRQ_3;
+    *SYSTEM_TIMER_C3 = *SYSTEM_TIMER_CLO + period;
+
+    irq_fiq_select(IRQ_SYSTEM_TIMER_3);
+    enableFIQ();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       fiq_stop
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function masks FIQ exceptions, and stops routing the
+//                  timer to the FIQ.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void fiq_stop()
+{
+    disableFIQ();
+    irq_fiq_clear();
+    *SYSTEM_TIMER_CS = 0x1 << SYSTEM_TIMER_IRQ_3;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       fiq_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the number of FIQ ticks, and the
+//                  largest delay (in microseconds) between a timer match
+//                  and the FIQ handler, to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void fiq_report()
+{
+    uart_puts("\nFIQ report:\n");
+    uart_puts("    ticks:  0x");
+    uart_puthex((unsigned int)fiqTicks);
+    uart_puts("\n    late max:  0x");
+    uart_puthex(fiqLateMax);
+    uart_puts("\n");
+}
@@ -0,0 +1,20 @@
+#ifndef FIQ_H
+#define FIQ_H
+
+// Definitions and function prototypes for the FIQ tick in fiq.c. The FIQ
+// handler itself is written in assembly, in startV2.s.
+
+// Default time between FIQ ticks, in microseconds
+#define FIQ_PERIOD              1000
+
+// FIQ tick global variables, updated by the FIQ handler
+extern volatile unsigned int fiqPeriod;
+extern volatile unsigned long fiqTicks;
+extern volatile unsigned int fiqLateMax;
+
+// Function prototypes
+void fiq_start(unsigned int period);
+void fiq_stop();
+void fiq_report();
+
+#endif
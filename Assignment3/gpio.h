@@ -1,3 +1,6 @@
+#ifndef GPIO_H
+#define GPIO_H
+
 // The addresses of the GPIO registers.
 //
 // These are defined on page 90 - 91 of the Broadcom BCM2837 ARM Peripherals
@@ -37,3 +40,46 @@
 #define GPPUD           ((volatile unsigned int *)(MMIO_BASE + 0x00200094))
 #define GPPUDCLK0       ((volatile unsigned int *)(MMIO_BASE + 0x00200098))
 #define GPPUDCLK1       ((volatile unsigned int *)(MMIO_BASE + 0x0020009C))
+
+// Number of GPIO pins (0 - 53)
+#define GPIO_PINS       54
+
+// Values of the 3-bit function select (FSEL) field of a pin.
+// See page 92 of the Broadcom BCM2837 ARM Peripherals Manual.
+#define GPIO_INPUT      0x0
+#define GPIO_OUTPUT     0x1
+#define GPIO_ALT0       0x4
+#define GPIO_ALT1       0x5
+#define GPIO_ALT2       0x6
+#define GPIO_ALT3       0x7
+#define GPIO_ALT4       0x3
+#define GPIO_ALT5       0x2
+
+// Values of the pull-up/down control field of the GPPUD register
+#define GPIO_PULL_NONE  0x0
+#define GPIO_PULL_DOWN  0x1
+#define GPIO_PULL_UP    0x2
+
+// Edge detection settings for an input pin
+#define GPIO_EDGE_NONE      0x0
+#define GPIO_EDGE_RISING    0x1
+#define GPIO_EDGE_FALLING   0x2
+#define GPIO_EDGE_BOTH      0x3
+
+// One entry in a pin-configuration table, applied with gpio_configure()
+struct gpio_pin_config {
+    unsigned int pin;
+    unsigned int function;
+    unsigned int pull;
+    unsigned int edge;
+};
+
+// Function prototypes for the GPIO driver in gpio.c. The mask-based
+// functions work on GPIO bank 0 (pins 0 - 31), where bit n is pin n.
+void gpio_set_function(unsigned int pin, unsigned int function);
+void gpio_set_pull(unsigned int mask, unsigned int pull);
+void gpio_configure(struct gpio_pin_config *table, int count);
+void gpio_write_mask(unsigned int setMask, unsigned int clearMask);
+unsigned int gpio_read_all();
+
+#endif
@@ -0,0 +1,198 @@
+// The functions in this file implement a queue of GPIO edge events. The
+// IRQ dispatcher calls gpio_event_irq(), which records every pin with a set
+// bit in the GPIO Event Detect Status Registers, so that no edge is lost
+// when several pins fire together. The main loop then takes the events off
+// the queue one at a time with gpio_event_pop(), or in batches with
+// gpio_event_drain().
+//
+// The queue is a single-producer, single-consumer ring buffer. Only the
+// interrupt handler writes the head index, and only the main loop writes
+// the tail index, so no locks are needed and interrupts never have to be
+// disabled by the main loop. A memory barrier orders the write of an event
+// before the index update that publishes it. When the queue is full, new
+// events are dropped and counted in gpioEventsDropped.
+
+// Header files
+#include "gpio.h"
+#include "systimer.h"
+#include "gpioevent.h"
+
+// Queue global variables. The head is the next slot to be written, and the
+// tail is the next slot to be read. Both only ever increase, and are masked
+// to find the slot, so the queue is empty when they are equal.
+struct gpio_event gpioEventQueue[GPIO_EVENT_QUEUE_SIZE];
+volatile unsigned int gpioEventHead;
+volatile unsigned int gpioEventTail;
+volatile unsigned int gpioEventsDropped;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_event_push
+//
+//  Arguments:      pin:          The GPIO pin number
+//                  edge:         GPIO_EDGE_RISING or GPIO_EDGE_FALLING
+//                  timestamp:    The System Timer count of the edge
+//
+//  Returns:        TRUE (non-zero) if the event was queued, FALSE (zero) if
+//                  the queue was full and the event was dropped.
+//
+//  Description:    This function adds an event to the head of the queue.
+//                  It must only be called from the interrupt handler (the
+//                  single producer).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gpio_event_push(unsigned int pin, unsigned int edge, unsigned long timestamp)
+{
+    unsigned int head = gpioEventHead;
+    struct gpio_event *event;
+
+    if (head - gpioEventTail >= GPIO_EVENT_QUEUE_SIZE) {
+        gpioEventsDropped++;
+        return 0;
+    }
+
+    event = &gpioEventQueue[head & (GPIO_EVENT_QUEUE_SIZE - 1)];
+    event->pin = pin;
+    event->edge = edge;
+    event->timestamp = timestamp;
+
+    // Make sure the event is written before it is published
+    asm volatile("dmb ish" : : : "memory");
+    gpioEventHead = head + 1;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_event_pop
+//
+//  Arguments:      event:     Where to copy the oldest event
+//
+//  Returns:        TRUE (non-zero) if an event was copied, FALSE (zero) if
+//                  the queue is empty.
+//
+//  Description:    This function removes the oldest event from the tail of
+//                  the queue. It must only be called from the main loop
+//                  (the single consumer).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gpio_event_pop(struct gpio_event *event)
+{
+    return gpio_event_drain(event, 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_event_drain
+//
+//  Arguments:      events:    An array to copy the events into
+//                  max:       The number of events the array can hold
+//
+//  Returns:        The number of events copied.
+//
+//  Description:    This function removes up to max of the oldest events from
+//                  the queue, in the order they happened. The tail index is
+//                  only updated once, after all of the events are copied,
+//                  which releases their slots to the interrupt handler.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gpio_event_drain(struct gpio_event *events, int max)
+{
+    unsigned int tail = gpioEventTail;
+    unsigned int available = gpioEventHead - tail;
+    int i;
+
+    // Make sure the events are read after the head index
+    asm volatile("dmb ish" : : : "memory");
+
+    if (available > (unsigned int)max) {
+        available = max;
+    }
+
+    for (i = 0; i < (int)available; i++) {
+        events[i] = gpioEventQueue[(tail + i) & (GPIO_EVENT_QUEUE_SIZE - 1)];
+    }
+
+    // Make sure the events are copied before their slots are released
+    asm volatile("dmb ish" : : : "memory");
+    gpioEventTail = tail + available;
+
+    return available;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_event_irq
+//
+//  Arguments:      irq:     The interrupt number (IRQ_GPIO_3)
+//
+//  Returns:        void
+//
+//  Description:    This function is the interrupt handler for the GPIO
+//                  interrupts (see irq_register()). It reads both GPIO Event Detect Status
+//                  Registers and clears all of the set bits at once, by
+//                  writing the same bits back. Each set bit is then queued
+//                  as an event, lowest pin first. The event detect status
+//                  does not say which kind of edge was seen, so this is
+//                  worked out from the edge detection enabled for the pin:
+//                  if both edges are enabled, the current pin level is used
+//                  (a high level means the edge was rising).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gpio_event_irq(unsigned int irq)
+{
+    unsigned int pending[2], rising[2], falling[2], level[2];
+    unsigned int bank, pin, bit, edge;
+    unsigned long now;
+
+    // Read and clear the event detect status of both banks
+    pending[0] = *GPEDS0;
+    pending[1] = *GPEDS1;
+    if (pending[0]) {
+        *GPEDS0 = pending[0];
+    }
+    if (pending[1]) {
+        *GPEDS1 = pending[1];
+    }
+
+    now = get_timer_counter();
+
+    rising[0] = *GPREN0 | *GPAREN0;
+    rising[1] = *GPREN1 | *GPAREN1;
+    falling[0] = *GPFEN0 | *GPAFEN0;
+    falling[1] = *GPFEN1 | *GPAFEN1;
+    level[0] = *GPLEV0;
+    level[1] = *GPLEV1;
+
+    for (bank = 0; bank < 2; bank++) {
+        // Visit each set bit, using count trailing zeros to find it
+        while (pending[bank]) {
+            pin = __builtin_ctz(pending[bank]);
+            bit = 0x1 << pin;
+            pending[bank] &= ~bit;
+
+            if ((rising[bank] & bit) && !(falling[bank] & bit)) {
+                edge = GPIO_EDGE_RISING;
+            } else if ((falling[bank] & bit) && !(rising[bank] & bit)) {
+                edge = GPIO_EDGE_FALLING;
+            } else {
+                edge = (level[bank] & bit) ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING;
+            }
+
+            gpio_event_push(bank * 32 + pin, edge, now);
+        }
+    }
+}
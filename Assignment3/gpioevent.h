@@ -0,0 +1,28 @@
+#ifndef GPIOEVENT_H
+#define GPIOEVENT_H
+
+// Definitions and function prototypes for the GPIO edge-event queue
+// in gpioevent.c
+
+// Number of events the queue can hold (must be a power of 2)
+#define GPIO_EVENT_QUEUE_SIZE   64
+
+// One edge on an input pin, and the System Timer count when the
+// interrupt handler saw it. The edge is GPIO_EDGE_RISING or
+// GPIO_EDGE_FALLING (see gpio.h).
+struct gpio_event {
+    unsigned int pin;
+    unsigned int edge;
+    unsigned long timestamp;
+};
+
+// Number of events lost because the queue was full
+extern volatile unsigned int gpioEventsDropped;
+
+// Function prototypes
+void gpio_event_irq(unsigned int irq);
+int gpio_event_push(unsigned int pin, unsigned int edge, unsigned long timestamp);
+int gpio_event_pop(struct gpio_event *event);
+int gpio_event_drain(struct gpio_event *events, int max);
+
+#endif
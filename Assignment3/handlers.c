@@ -1,70 +1,29 @@
 // This file contains C functions to handle particular kinds of exceptions.
-// Only a function to handle IRQ exceptions is currently implemented.
+// Only a function to handle IRQ exceptions is implemented here. The other
+// exceptions are handled by exception_handler() in common/exceptions.c.
 
 // Header files
-#include "uart.h"
-#include "gpio.h"
 #include "irq.h"
-#include "sysreg.h"
+#include "smp.h"
+#include "localtimer.h"
 
-// Reference to the global shared value
-extern unsigned int sharedValue;
-
-// This function detects and handles the interrupts
-void IRQ_handler()
+// This function handles the interrupts. Each pending interrupt is passed to
+// the handler registered for it (see irq.c). Nothing is printed here, since
+// writing to the UART would keep interrupts masked for milliseconds. The
+// argument points to the registers of the interrupted code, saved by the
+// IRQ stub in common/vectors.s.
+void IRQ_handler(unsigned long *frame)
 {
-    unsigned int r;
-
-    // Print out exception type
-    uart_puts("\nInside IRQ exception handler:\n");
-
-    // Print out further information about the exception    
-    r = getCurrentEL();
-    uart_puts("    CurrentEL is:  0x");
-    uart_puthex(r);
-    uart_puts("\n");
+    // Run the functions sent to this core by the other cores, and handle
+    // the timer of this core. The GPU interrupts are only routed to core 0.
+    smp_ipi();
+    local_timer_irq();
+    if (smp_core() != 0) {
+        return;
+    }
 
-    r = getDAIF();
-    uart_puts("    DAIF is:  0x");
-    uart_puthex(r);
-    uart_puts("\n");
+    irq_dispatch(frame);
 
-    r = *IRQ_PENDING_2;
-    uart_puts("    IRQ_PENDING_2 is:  0x");
-    uart_puthex(r);
-    uart_puts("\n");
-    
-    r = *GPEDS0;
-    uart_puts("    GPEDS0 is:  0x");
-    uart_puthex(r);
-    uart_puts("\n");
-    	
-    // Handle GPIO interrupts in general
-    if (*IRQ_PENDING_2 == 0x00100000) 
-	{
-		// Handle the interrupt associated with GPIO pin 23
-		if (*GPEDS0 == (0x1 << 23)) 
-		{
-			// Clear the interrupt by writing a 1 to the GPIO Event Detect
-			// Status Register at bit 23
-			*GPEDS0 = (0x1 << 23);
-        
-			// Handle the interrupt:
-			// We do this by setting the sharedValue to 0
-			sharedValue = 0;
-		}
-		// Handle the interrupt associated with GPIO pin 24
-		if (*GPEDS0 == (0x1 << 24)) 
-		{
-			// Clear the interrupt by writing a 1 to the GPIO Event Detect
-			// Status Register at bit 24
-			*GPEDS0 = (0x1 << 24);
-        
-			// Handle the interrupt:
-			// We do this by setting the sharedValue to 1
-			sharedValue = 1;
-		}
-    }
     // Return to the IRQ exception handler stub
     return;
 }
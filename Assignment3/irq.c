@@ -0,0 +1,258 @@
+// The functions in this file dispatch interrupts to the handlers registered
+// for them. The IRQ exception handler calls irq_dispatch(), which reads the
+// basic pending register first, and only reads the other two pending
+// registers if the basic register shows they have something pending. The
+// set bits of each register are visited lowest first with count trailing
+// zeros (rbit and clz), and the handler of each interrupt is called, so the
+// time spent depends only on the interrupts that are actually pending.
+// Several devices can then use interrupts at the same time, each with its
+// own handler.
+//
+// Only the interrupts enabled through irq_enable() are dispatched. An
+// enabled interrupt with no handler is disabled the first time it is seen,
+// so that it cannot keep the processor in the exception handler. It is
+// logged later by the main loop, through the work queue.
+
+// Header files
+#include "uart.h"
+#include "irq.h"
+#include "workqueue.h"
+
+// Interrupt dispatcher global variables: the handler of every interrupt,
+// and the enabled interrupts of each pending register (IRQ_PENDING_1,
+// IRQ_PENDING_2, and IRQ_BASIC_PENDING)
+irq_handler_t irqHandler[IRQ_COUNT];
+unsigned int irqEnabled[3];
+unsigned int irqSpurious;
+
+// The registers of the interrupted code, saved by the IRQ exception stub,
+// for handlers that need to look at them
+unsigned long *irqFrame;
+
+// The enable and disable registers of each pending register
+volatile unsigned int *irqEnableRegister[3] =
+    {
+        IRQ_ENABLE_IRQS_1, IRQ_ENABLE_IRQS_2, IRQ_ENABLE_BASIC_IRQS
+    };
+
+volatile unsigned int *irqDisableRegister[3] =
+    {
+        IRQ_DISABLE_IRQS_1, IRQ_DISABLE_IRQS_2, IRQ_DISABLE_BASIC_IRQS
+    };
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_register
+//
+//  Arguments:      irq:        The interrupt number (0 to IRQ_COUNT - 1)
+//                  handler:    The function to call when it is pending, or 0
+//                              to remove the handler
+//
+//  Returns:        0 if the handler was registered, or -1 if the interrupt
+//                  number is not valid.
+//
+//  Description:    This function sets the handler of an interrupt. The
+//                  interrupt must then be enabled with irq_enable().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int irq_register(unsigned int irq, irq_handler_t handler)
+{
+    if (irq >= IRQ_COUNT) {
+        return -1;
+    }
+
+    irqHandler[irq] = handler;
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_enable
+//
+//  Arguments:      irq:     The interrupt number
+//
+//  Returns:        void
+//
+//  Description:    This function enables an interrupt in the interrupt
+//                  controller. Writing a 1 bit to an enable register only
+//                  enables that interrupt, so no read-modify-write is needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_enable(unsigned int irq)
+{
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    irqEnabled[irq >> 5] |= 0x1 << (irq & 31);
+    *irqEnableRegister[irq >> 5] = 0x1 << (irq & 31);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_disable
+//
+//  Arguments:      irq:     The interrupt number
+//
+//  Returns:        void
+//
+//  Description:    This function disables an interrupt in the interrupt
+//                  controller.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_disable(unsigned int irq)
+{
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    *irqDisableRegister[irq >> 5] = 0x1 << (irq & 31);
+    irqEnabled[irq >> 5] &= ~(0x1 << (irq & 31));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_log_spurious
+//
+//  Arguments:      irq:     The interrupt number
+//
+//  Returns:        void
+//
+//  Description:    This function is queued as work when an interrupt with no
+//                  handler is disabled, and writes its number to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_log_spurious(unsigned long irq)
+{
+    uart_puts("Spurious IRQ disabled:  0x");
+    uart_puthex(irq);
+    uart_puts("\n");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_dispatch_bank
+//
+//  Arguments:      bank:       The pending register (0, 1, or 2)
+//                  pending:    The pending interrupts of the register
+//
+//  Returns:        void
+//
+//  Description:    This function calls the handler of every pending
+//                  interrupt of one register, lowest number first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_dispatch_bank(unsigned int bank, unsigned int pending)
+{
+    unsigned int irq;
+
+    pending &= irqEnabled[bank];
+    while (pending) {
+        irq = (bank << 5) + __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        if (irqHandler[irq]) {
+            irqHandler[irq](irq);
+        } else {
+            irqSpurious++;
+            irq_disable(irq);
+            work_queue(irq_log_spurious, irq);
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_dispatch
+//
+//  Arguments:      frame:     The registers saved by the IRQ exception stub
+//
+//  Returns:        void
+//
+//  Description:    This function is called by the IRQ exception handler. It
+//                  calls the handler of every pending interrupt. The GPU
+//                  pending registers are only read if the basic pending
+//                  register has a bit set for them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_dispatch(unsigned long *frame)
+{
+    unsigned int basic = *IRQ_BASIC_PENDING;
+
+    irqFrame = frame;
+
+    if (basic & IRQ_BASIC_BANK_1) {
+        irq_dispatch_bank(0, *IRQ_PENDING_1);
+    }
+    if (basic & IRQ_BASIC_BANK_2) {
+        irq_dispatch_bank(1, *IRQ_PENDING_2);
+    }
+    if (basic & IRQ_BASIC_ARM) {
+        irq_dispatch_bank(2, basic & IRQ_BASIC_ARM);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_fiq_select
+//
+//  Arguments:      irq:     The interrupt number
+//
+//  Returns:        void
+//
+//  Description:    This function routes one interrupt to the FIQ, replacing
+//                  any interrupt routed there before. The interrupt is
+//                  disabled as an IRQ first, since a source must not be
+//                  enabled as both (see page 116 of the Peripherals Manual).
+//                  FIQ exceptions must then be unmasked with enableFIQ().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_fiq_select(unsigned int irq)
+{
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    irq_disable(irq);
+    *IRQ_FIQ_CONTROL = irq | IRQ_FIQ_ENABLE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_fiq_clear
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function stops routing any interrupt to the FIQ.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_fiq_clear()
+{
+    *IRQ_FIQ_CONTROL = 0;
+}
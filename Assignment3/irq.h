@@ -1,3 +1,6 @@
+#ifndef IRQ_H
+#define IRQ_H
+
 // The addresses of the Broadcom interrupt controller registers.
 //
 // These are defined on page 112 of the Broadcom BCM2837 ARM Peripherals
@@ -17,3 +20,48 @@
 #define IRQ_DISABLE_IRQS_1      ((volatile unsigned int *)(MMIO_BASE + 0x0000B21C))
 #define IRQ_DISABLE_IRQS_2      ((volatile unsigned int *)(MMIO_BASE + 0x0000B220))
 #define IRQ_DISABLE_BASIC_IRQS	((volatile unsigned int *)(MMIO_BASE + 0x0000B224))
+
+// Interrupt numbers. IRQs 0 to 31 are the GPU interrupts in IRQ_PENDING_1,
+// 32 to 63 are those in IRQ_PENDING_2 (see the table on page 113 of the
+// Peripherals Manual), and 64 to 71 are the ARM interrupts in bits 0 to 7
+// of IRQ_BASIC_PENDING.
+#define IRQ_COUNT               72
+#define IRQ_SYSTEM_TIMER_1      1
+#define IRQ_SYSTEM_TIMER_3      3
+#define IRQ_GPIO_0              49
+#define IRQ_GPIO_1              50
+#define IRQ_GPIO_2              51
+#define IRQ_GPIO_3              52      // GPIO_int[3]: all GPIO pins
+#define IRQ_UART                57
+#define IRQ_ARM_TIMER           64
+#define IRQ_ARM_MAILBOX         65
+
+// Bits of IRQ_BASIC_PENDING showing that IRQ_PENDING_1 or IRQ_PENDING_2
+// must be read. Bits 8 and 9 are set if there are pending interrupts in
+// the registers, other than the ones that have shortcut bits (bits 10 to
+// 14 for IRQ_PENDING_1, and 15 to 20 for IRQ_PENDING_2).
+#define IRQ_BASIC_BANK_1        ((0x1 << 8) | (0x1F << 10))
+#define IRQ_BASIC_BANK_2        ((0x1 << 9) | (0x3F << 15))
+#define IRQ_BASIC_ARM           0xFF
+
+// Bit of IRQ_FIQ_CONTROL that routes the interrupt given in bits 0 to 6
+// (numbered as above) to the FIQ instead of the IRQ
+#define IRQ_FIQ_ENABLE          0x80
+
+// The frame of the interrupted code, while an interrupt is being handled.
+// Its layout is given by the FRAME_* constants in exceptions.h.
+extern unsigned long *irqFrame;
+
+// An interrupt handler. It is passed the number of the interrupt, so one
+// function can handle several.
+typedef void (*irq_handler_t)(unsigned int irq);
+
+// Function prototypes for the interrupt dispatcher in irq.c
+int irq_register(unsigned int irq, irq_handler_t handler);
+void irq_enable(unsigned int irq);
+void irq_disable(unsigned int irq);
+void irq_dispatch(unsigned long *frame);
+void irq_fiq_select(unsigned int irq);
+void irq_fiq_clear();
+
+#endif
@@ -0,0 +1,289 @@
+// The functions in this file measure how long it takes to enter and leave
+// an interrupt handler, in CPU cycles. The benchmark arms System Timer
+// compare channel 1 a short time ahead, and then waits in a loop that does
+// nothing but copy the cycle counter into register x9 until register x10
+// becomes non-zero. When the interrupt is taken, the IRQ stub saves both
+// registers in its frame, so the handler knows the cycle count of the last
+// instruction run before the interrupt (to within one loop pass, which is
+// two instructions). The handler reads the cycle counter as soon as it is
+// called, which gives the entry latency: taking the exception, the stub
+// saving the registers, and the dispatcher reading the pending registers
+// and finding the handler. The handler then sets x10 in the frame, and
+// reads the cycle counter again as the last thing it does. The wait loop
+// reads the cycle counter once it sees x10 restored as non-zero, which
+// gives the exit latency: returning through the dispatcher, the stub
+// restoring the registers, and the exception return.
+//
+// The latencies are collected in histograms, and written to the console by
+// irq_bench_report(). They do not include the time the timer takes to
+// signal the interrupt controller, which the CPU cannot see.
+
+// Header files
+#include "uart.h"
+#include "irq.h"
+#include "systimer.h"
+#include "irqbench.h"
+
+// Latency statistics, in cycles
+struct irq_bench_stats {
+    unsigned int count;
+    unsigned int min;
+    unsigned int max;
+    unsigned long total;
+    unsigned int histogram[IRQ_BENCH_BUCKETS];
+};
+
+// Benchmark global variables
+struct irq_bench_stats irqBenchEntry;
+struct irq_bench_stats irqBenchExit;
+unsigned long irqBenchExitCycles;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_cycles
+//
+//  Arguments:      none
+//
+//  Returns:        The value of the PMU cycle counter.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned long irq_bench_cycles()
+{
+    unsigned long cycles;
+
+    asm volatile("mrs %0, pmccntr_el0" : "=r" (cycles));
+    return cycles;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_clear
+//
+//  Arguments:      stats:     The statistics to clear
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_bench_clear(struct irq_bench_stats *stats)
+{
+    int i;
+
+    stats->count = 0;
+    stats->min = 0xFFFFFFFF;
+    stats->max = 0;
+    stats->total = 0;
+    for (i = 0; i < IRQ_BENCH_BUCKETS; i++) {
+        stats->histogram[i] = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_record
+//
+//  Arguments:      stats:     The statistics to add to
+//                  cycles:    A latency, in cycles
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_bench_record(struct irq_bench_stats *stats, unsigned int cycles)
+{
+    unsigned int bucket = cycles / IRQ_BENCH_BUCKET_WIDTH;
+
+    if (bucket >= IRQ_BENCH_BUCKETS) {
+        bucket = IRQ_BENCH_BUCKETS - 1;
+    }
+    stats->histogram[bucket]++;
+
+    stats->count++;
+    stats->total += cycles;
+    if (cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_tick
+//
+//  Arguments:      irq:     The interrupt number (IRQ_SYSTEM_TIMER_1)
+//
+//  Returns:        void
+//
+//  Description:    This function is the interrupt handler of the benchmark.
+//                  The cycle counter is read first and last, so that as
+//                  little as possible of the handler itself is measured.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_bench_tick(unsigned int irq)
+{
+    unsigned long entry = irq_bench_cycles();
+    unsigned long *frame = irqFrame;
+
+    // Clear the timer match, so the interrupt is no longer pending
+    *SYSTEM_TIMER_CS = 0x1 << SYSTEM_TIMER_IRQ_1;
+
+    // The wait loop keeps the cycle count in x9, and stops when x10 is set
+    irq_bench_record(&irqBenchEntry, (unsigned int)(entry - frame[9]));
+    frame[10] = 1;
+
+    irqBenchExitCycles = irq_bench_cycles();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_wait
+//
+//  Arguments:      none
+//
+//  Returns:        The value of the cycle counter just after the benchmark
+//                  interrupt has returned.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long irq_bench_wait()
+{
+    unsigned long after;
+
+    asm volatile("mov   x10, 0\n"
+                 "1:    mrs   x9, pmccntr_el0\n"
+                 "      cbz   x10, 1b\n"
+                 "      mrs   %0, pmccntr_el0\n"
+                 : "=r" (after) : : "x9", "x10", "memory");
+    return after;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_run
+//
+//  Arguments:      samples:     The number of interrupts to measure
+//
+//  Returns:        void
+//
+//  Description:    This function starts the cycle counter, and measures the
+//                  given number of timer interrupts. IRQ exceptions must be
+//                  enabled. The timer interrupt is disabled again at the end.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_bench_run(unsigned int samples)
+{
+    unsigned long pmcr, after;
+    unsigned int i;
+
+    // Start the cycle counter, counting every cycle with 64 bits
+    asm volatile("mrs %0, pmcr_el0" : "=r" (pmcr));
+    asm volatile("msr pmcr_el0, %0" : : "r" (pmcr | (0x1UL << 6) | 0x1));
+    asm volatile("msr pmcntenset_el0, %0" : : "r" (0x1UL << 31));
+    asm volatile("isb");
+
+    irq_bench_clear(&irqBenchEntry);
+    irq_bench_clear(&irqBenchExit);
+
+    irq_register(IRQ_SYSTEM_TIMER_1, irq_bench_tick);
+    irq_enable(IRQ_SYSTEM_TIMER_1);
+
+    for (i = 0; i < samples; i++) {
+        *SYSTEM_TIMER_CS = 0x1 << SYSTEM_TIMER_IRQ_1;
+        *SYSTEM_TIMER_C1 = *SYSTEM_TIMER_CLO + IRQ_BENCH_DELAY;
+
+        after = irq_bench_wait();
+        irq_bench_record(&irqBenchExit, (unsigned int)(after - irqBenchExitCycles));
+    }
+
+    irq_disable(IRQ_SYSTEM_TIMER_1);
+    irq_register(IRQ_SYSTEM_TIMER_1, 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_print
+//
+//  Arguments:      name:      The name of the latency
+//                  stats:     Its statistics
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void irq_bench_print(char *name, struct irq_bench_stats *stats)
+{
+    int i;
+
+    uart_puts("    ");
+    uart_puts(name);
+    uart_puts(" min:  0x");
+    uart_puthex(stats->count ? stats->min : 0);
+    uart_puts("\n    ");
+    uart_puts(name);
+    uart_puts(" mean:  0x");
+    uart_puthex(stats->count ? (unsigned int)(stats->total / stats->count) : 0);
+    uart_puts("\n    ");
+    uart_puts(name);
+    uart_puts(" max:  0x");
+    uart_puthex(stats->max);
+    uart_puts("\n");
+
+    for (i = 0; i < IRQ_BENCH_BUCKETS; i++) {
+        if (stats->histogram[i] == 0) {
+            continue;
+        }
+        uart_puts("        0x");
+        uart_puthex(i * IRQ_BENCH_BUCKET_WIDTH);
+        uart_puts(i == IRQ_BENCH_BUCKETS - 1 ? " and up:  0x" : ":  0x");
+        uart_puthex(stats->histogram[i]);
+        uart_puts("\n");
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       irq_bench_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the entry and exit latencies (in
+//                  cycles) of the last run to the console: the minimum, the
+//                  mean, the maximum, and the number of interrupts in each
+//                  bucket of the histogram, by the first cycle count of the
+//                  bucket. All values are hexadecimal.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void irq_bench_report()
+{
+    uart_puts("\nInterrupt latency report:\n");
+    uart_puts("    samples:  0x");
+    uart_puthex(irqBenchEntry.count);
+    uart_puts("\n");
+
+    irq_bench_print("entry", &irqBenchEntry);
+    irq_bench_print("exit", &irqBenchExit);
+}
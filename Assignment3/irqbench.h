@@ -0,0 +1,22 @@
+#ifndef IRQBENCH_H
+#define IRQBENCH_H
+
+// Definitions and function prototypes for the interrupt latency benchmark
+// in irqbench.c
+
+// Default number of interrupts measured
+#define IRQ_BENCH_SAMPLES       1000
+
+// Time from arming the timer compare to the interrupt, in microseconds
+#define IRQ_BENCH_DELAY         20
+
+// Latency histogram: IRQ_BENCH_BUCKETS buckets of IRQ_BENCH_BUCKET_WIDTH
+// cycles each. The last bucket also counts every longer latency.
+#define IRQ_BENCH_BUCKETS       16
+#define IRQ_BENCH_BUCKET_WIDTH  32
+
+// Function prototypes
+void irq_bench_run(unsigned int samples);
+void irq_bench_report();
+
+#endif
@@ -16,35 +16,71 @@
 #include "gpio.h"
 #include "irq.h"
 #include "systimer.h"
-
-// Function prototypes
-void init_GPIO23_to_risingEdgeInterrupt();
-void init_GPIO24_to_fallingEdgeInterrupt();
-
-void init_GPIO17_to_output();
-void set_GPIO17();
-void clear_GPIO17();
-
-void init_GPIO27_to_output();
-void set_GPIO27();
-void clear_GPIO27();
-
-void init_GPIO22_to_output();
-void set_GPIO22();
-void clear_GPIO22();
-
-// Declare a global shared variable
-unsigned int sharedValue;
+#include "gpioevent.h"
+#include "irqbench.h"
+#include "fiq.h"
+#include "workqueue.h"
+#include "smp.h"
+#include "mmu.h"
+#include "sync.h"
+#include "localtimer.h"
+
+// The LEDs are connected to GPIO pins 17, 27, and 22
+#define LED1    (0x1 << 17)
+#define LED2    (0x1 << 27)
+#define LED3    (0x1 << 22)
+
+// Pin configuration table, applied in one pass at boot. The LED pins are
+// outputs. The push buttons are on pins 23 and 24, which generate an
+// interrupt on a rising and a falling edge respectively. None of the pins
+// use the internal pull-up or pull-down resistors, since the buttons are
+// pulled down with external resistors connected to ground.
+struct gpio_pin_config pinConfig[] =
+    {
+        {17, GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {27, GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {22, GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {23, GPIO_INPUT,  GPIO_PULL_NONE, GPIO_EDGE_RISING},
+        {24, GPIO_INPUT,  GPIO_PULL_NONE, GPIO_EDGE_FALLING}
+    };
+
+// The push buttons on pins 23 and 24 select the state
+#define BUTTON_STATE1   23
+#define BUTTON_STATE2   24
+
+// The maximum number of events taken off the queue at once
+#define EVENT_BATCH     16
+
+// The maximum number of deferred work items run at once
+#define WORK_BATCH      8
+
+// Period of the tick of core 0, in microseconds. Core n ticks every
+// (n + 1) periods, on its own timer.
+#define CORE_TICK_PERIOD        1000
+
+// Start the tick of the core that calls this function. It is also the
+// entry function of the secondary cores.
+void core_tick_start(unsigned long arg)
+{
+    local_timer_init();
+    local_timer_start(CORE_TICK_PERIOD * (smp_core() + 1), 0);
+}
 
 // Starting point of the program
 void main()
 {
-    unsigned int r;
-    unsigned int localValue;
-    sharedValue = 0;
+    unsigned int r, state, previous, dropped;
+    struct gpio_event events[EVENT_BATCH];
+    int i, count;
+    unsigned int core;
 
     // Set up the UART serial port
     uart_init();
+
+    // Turn on the MMU and the caches, so that the cores can share data
+    // with the atomics in atomic.h. This program does not share memory
+    // with the video core, so all of the RAM is cached.
+    mmu_init(MMU_PERIPHERAL_BASE);
     
     // Query the current exception level
     r = getCurrentEL();
@@ -83,16 +119,19 @@ void main()
     uart_puthex(r);
     uart_puts("\n");
  
-    // Initialize the sharedValue global variable and
-    // and set the local variable to be same value
-    localValue = sharedValue = 0;
-    
+    // Start in state 1
+    state = 0;
+    previous = 0;
+    dropped = 0;
+
     // Initialize all the required pins
-    init_GPIO23_to_risingEdgeInterrupt();
-    init_GPIO24_to_fallingEdgeInterrupt();
-    init_GPIO17_to_output();
-    init_GPIO27_to_output();
-    init_GPIO22_to_output();
+    gpio_configure(pinConfig, sizeof(pinConfig) / sizeof(pinConfig[0]));
+
+    // Queue the edges on the push buttons with the handler in gpioevent.c,
+    // and enable the GPIO IRQS for ALL the GPIO pins (IRQ 52, GPIO_int[3]).
+    // See p. 117 in the Broadcom Peripherals Manual.
+    irq_register(IRQ_GPIO_3, gpio_event_irq);
+    irq_enable(IRQ_GPIO_3);
 
     // Enable IRQ Exceptions
     enableIRQ();
@@ -116,382 +155,89 @@ void main()
     uart_puts("New GPREN0 is:  0x");
     uart_puthex(r);
     uart_puts("\n");
+
+    // Measure the time taken to enter and leave the interrupt handler
+    irq_bench_run(IRQ_BENCH_SAMPLES);
+    irq_bench_report();
+
+    // Start the FIQ tick, which is not held up by the IRQ handlers
+    fiq_start(FIQ_PERIOD);
+
+    // Start the tick of this core, and the other cores, which each start
+    // their own tick. Check that each core answers a call.
+    core_tick_start(0);
+    for (core = 1; core < SMP_CORES; core++) {
+        if (smp_start(core, core_tick_start, 0) == 0) {
+            smp_call(core, smp_ping, 0);
+            smp_wait(core);
+        }
+    }
+    smp_report();
+
+    // Check the locks and queues shared between the cores
+    sync_stress();
     
     // Print out a message to the console
     uart_puts("\nRising Edge IRQ program starting.\n");
     
-    // Loop forever, waiting for interrupts to change the shared value
+    // Loop forever, handling the button events queued by the interrupt
+    // handler before each LED sequence
     while (1) 
     {
-        if (sharedValue == 0)
+        // Run the work deferred by the interrupt handlers
+        work_run(WORK_BATCH);
+
+        // Take all waiting events off the queue, in batches. The last
+        // button pressed selects the state.
+        do {
+            count = gpio_event_drain(events, EVENT_BATCH);
+            for (i = 0; i < count; i++) {
+                if (events[i].pin == BUTTON_STATE1) {
+                    state = 0;
+                } else if (events[i].pin == BUTTON_STATE2) {
+                    state = 1;
+                }
+            }
+        } while (count == EVENT_BATCH);
+
+        // Report the FIQ ticks, the work queue, and the per-core ticks
+        // whenever the state changes
+        if (state != previous) {
+            previous = state;
+            fiq_report();
+            work_report();
+            local_timer_report();
+        }
+
+        // Report any events that were lost because the queue was full
+        if (gpioEventsDropped != dropped) {
+            dropped = gpioEventsDropped;
+            uart_puts("GPIO events dropped:  0x");
+            uart_puthex(dropped);
+            uart_puts("\n");
+        }
+
+        if (state == 0)
         {
-            set_GPIO17();
-            clear_GPIO27();
-            clear_GPIO22();
+            gpio_write_mask(LED1, LED2 | LED3);
             microsecond_delay(500000);
 
-            clear_GPIO17();
-            set_GPIO27();
-            clear_GPIO22();
+            gpio_write_mask(LED2, LED1 | LED3);
             microsecond_delay(500000);
 
-            clear_GPIO17();
-            clear_GPIO27();
-            set_GPIO22();
+            gpio_write_mask(LED3, LED1 | LED2);
             microsecond_delay(500000);
         }
         else
         {
-            clear_GPIO17();
-            clear_GPIO27();
-            set_GPIO22();
+            gpio_write_mask(LED3, LED1 | LED2);
             microsecond_delay(250000);
 
-            clear_GPIO17();
-            set_GPIO27();
-            clear_GPIO22();
+            gpio_write_mask(LED2, LED1 | LED3);
             microsecond_delay(250000);
 
-            set_GPIO17();
-            clear_GPIO27();
-            clear_GPIO22();
+            gpio_write_mask(LED1, LED2 | LED3);
             microsecond_delay(250000);
         }
     }
 }
-
-// This function sets GPIO pin 23 to an input pin without
-// any internal pull-up or pull-down resistors.
-void init_GPIO23_to_risingEdgeInterrupt()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 2
-    r = *GPFSEL2;
-
-    // We clear the bits by ANDing with a 000 bit pattern in the field. This
-    // sets the pin to be an input pin
-    r &= ~(0x7 << 9);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 2
-    *GPFSEL2 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 17. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. We
-    // will pull down the pin using an external resistor connected to ground.
-
-    // Disable internal pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 17 to
-    // clock in the control signal for GPIO pin 17. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 23);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-    
-    // Set pin 23 to so that it generates an interrupt on a rising edge.
-    // We do so by setting bit 23 in the GPIO Rising Edge Detect Enable
-    // Register 0 to a 1 value (p. 97 in the Broadcom manual).
-    *GPREN0 = (0x1 << 23);
-    
-    // Enable the GPIO IRQS for ALL the GPIO pins by setting IRQ 52
-    // GPIO_int[3] in the Interrupt Enable Register 2 to a 1 value.
-    // See p. 117 in the Broadcom Peripherals Manual.
-    *IRQ_ENABLE_IRQS_2 = (0x1 << 20);
-}
-
-// This function sets GPIO pin 24 to an input pin without
-// any internal pull-up or pull-down resistors.
-void init_GPIO24_to_fallingEdgeInterrupt()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 2
-    r = *GPFSEL2;
-
-    // We clear the bits by ANDing with a 000 bit pattern in the field. This
-    // sets the pin to be an input pin
-    r &= ~(0x7 << 12);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 2
-    *GPFSEL2 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 24. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. We
-    // will pull down the pin using an external resistor connected to ground.
-
-    // Disable internal pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 24 to
-    // clock in the control signal for GPIO pin 24. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 24);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-    
-    // Set pin 24 to so that it generates an interrupt on a rising edge.
-    // We do so by setting bit 17 in the GPIO Rising Edge Detect Enable
-    // Register 0 to a 1 value (p. 97 in the Broadcom manual).
-    *GPFEN0 = (0x1 << 24);
-    
-    // Enable the GPIO IRQS for ALL the GPIO pins by setting IRQ 52
-    // GPIO_int[3] in the Interrupt Enable Register 2 to a 1 value.
-    // See p. 117 in the Broadcom Peripherals Manual.
-    *IRQ_ENABLE_IRQS_2 = (0x1 << 20);
-}
-
-// This function sets GPIO pin 17 to an output pin without
-// any pull-up or pull-down resistors.
-void init_GPIO17_to_output()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 1
-    r = *GPFSEL1;
-
-    // We clear the bits by ANDing with a 000 bit pattern in the field.
-    r &= ~(0x7 << 21);
-
-    // Set the field FSEL23 to 001, which sets pin 17 to an output pin.
-    // We do so by ORing the bit pattern 001 into the field.
-    r |= (0x1 << 21);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 1
-    *GPFSEL1 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 17. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. The
-    // internal pull-up and pull-down resistor isn't needed for an output pin.
-
-    // Disable pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 17 to
-    // clock in the control signal for GPIO pin 17. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 17);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-//This function sets the GPIO output pin 17 to a 1 (high) level.
-void set_GPIO17()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the SET17 field of the GPIO Pin Output Set Register 0
-	  r = (0x1 << 17);
-	  *GPSET0 = r;
-}
-
-// This function clears the GPIO output pin 17 to a 0 (low) level.
-void clear_GPIO17()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the CLR17 field of the GPIO Pin Output Clear Register 0
-	  r = (0x1 << 17);
-	  *GPCLR0 = r;
-}
-
-// This function sets GPIO pin 27 to an output pin without
-// any pull-up or pull-down resistors.
-
-void init_GPIO27_to_output()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 2
-    r = *GPFSEL2;
-
-    // We clear the bits by ANDing with a 000 bit pattern in the field.
-    r &= ~(0x7 << 21);
-
-    // Set the field FSEL27 to 001, which sets pin 27 to an output pin.
-    // We do so by ORing the bit pattern 001 into the field.
-    r |= (0x1 << 21);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 2
-    *GPFSEL2 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 27. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. The
-    // internal pull-up and pull-down resistor isn't needed for an output pin.
-
-    // Disable pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 27 to
-    // clock in the control signal for GPIO pin 27. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 27);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-// This function sets the GPIO output pin 27 to a 1 (high) level.
-void set_GPIO27()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the SET27 field of the GPIO Pin Output Set Register 0
-	  r = (0x1 << 27);
-	  *GPSET0 = r;
-}
-
-// This function clears the GPIO output pin 27 to a 0 (low) level.
-void clear_GPIO27()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the CLR27 field of the GPIO Pin Output Clear Register 0
-	  r = (0x1 << 27);
-	  *GPCLR0 = r;
-}
-
-// This function sets GPIO pin 22 to an output pin without
-// any pull-up or pull-down resistors.
-void init_GPIO22_to_output()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 2
-    r = *GPFSEL2;
-
-    // We clear the bits by ANDing with a 000 bit pattern in the field.
-    r &= ~(0x7 << 6);
-
-    // Set the field FSEL22 to 001, which sets pin 22 to an output pin.
-    // We do so by ORing the bit pattern 001 into the field.
-    r |= (0x1 << 6);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 2
-    *GPFSEL2 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 22. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. The
-    // internal pull-up and pull-down resistor isn't needed for an output pin.
-
-    // Disable pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 22 to
-    // clock in the control signal for GPIO pin 22. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 22);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-      asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-// This function sets the GPIO output pin 22 to a 1 (high) level.
-void set_GPIO22()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the SET22 field of the GPIO Pin Output Set Register 0
-	  r = (0x1 << 22);
-	  *GPSET0 = r;
-}
-
-// This function clears the GPIO output pin 22 to a 0 (low) level.
-
-void clear_GPIO22()
-{
-	  register unsigned int r;
-	  
-	  // Put a 1 into the CLR22 field of the GPIO Pin Output Clear Register 0
-	  r = (0x1 << 22);
-	  *GPCLR0 = r;
-}
@@ -1,6 +1,7 @@
 // This routine is used to establish an environment in which
 // a C program can run. We create this environment only on
-// CPU Core 0. The other cores simply run an infinite loop.
+// CPU Core 0. The other cores wait until they are started by
+// smp_start() in common/smp.c.
 //
 // The stack pointer register is initialized to point
 // just below the text section of the program. It grows
@@ -15,9 +16,9 @@
 //
 // This version of the start routine also changes the exception
 // level from EL2 to EL1 (in the aarch64 execution state).
-// The exception vector table is also set up, and vector
-// stubs are provided. Only the IRQ handler is implemented,
-// and is called from the IRQ stub.
+// The exception vector table is also set up, and the FIQ
+// handler is provided. The vector table and the other exception
+// stubs are in common/vectors.s.
 	
 	
 	// Put the machine code for this routine into the .text.boot section	
@@ -37,7 +38,21 @@ _start:
 	tst	x1, 0x3		// Bitwise AND rightmost 2 bits
 	b.eq	core_zero	// Skip forward if both bits are 0
 
-	//  If here, the CPU Core number is not 0, so loop forever
+	//  If here, the CPU Core number is not 0. If the firmware started
+	//  this core here as well, it waits until smp_start() (see
+	//  common/smp.c) writes an entry address to its spin table slot at
+	//  0xD8 + 8 * core number, and then jumps to it.
+	and	x1, x1, 0x3
+	mov	x2, 0xD8
+	add	x2, x2, x1, lsl 3
+spin:	ldr	x3, [x2]	// Read the spin table slot
+	cbnz	x3, released	// Leave the loop once it is set
+	wfe			// Wait for event
+	b	spin
+released:
+	br	x3
+
+	//  Infinite loop, used if main() returns
 loop:  	wfe			// Wait for event
 	b	loop		// Infinite loop
 
@@ -49,11 +64,14 @@ core_zero:
 	// begins. The stack grows backwards (towards 0), so it uses memory
 	// that has lower addresses than the _start routine. We need to
 	// set this properly so that C functions and assembly routines
-	// can allocate stack frames. We set the EL1 SP here, and will set
-	// the EL0 SP below, once we have changed to EL1.
+	// can allocate stack frames. The program itself runs on the EL0 SP,
+	// which is set below once we have changed to EL1. Exception handlers
+	// run on the EL1 SP, so we give it its own stack 128 KB further
+	// down, where it cannot overwrite the stack frames of the program.
 	adrp	x1, _start	// Put the _start address into x1
 	add	x1, x1, :lo12:_start
-	msr	sp_el1, x1	// Copy the address into the EL1 SP register
+	sub	x2, x1, 0x20000	// Exception stack starts 128 KB lower
+	msr	sp_el1, x2	// Copy the address into the EL1 SP register
 
 	// Enable AArch64 in EL1 by setting bits RW and SWIC to 1 in the
 	// Hypervisor Configuration Register (see p. D10-2492 and D10-2503
@@ -65,8 +83,26 @@ core_zero:
 	orr	x0, x0, (1 << 1)	// SWIO is hardwired on the Pi3
 	msr	hcr_el2, x0
 
+	// Give EL1 access to all of the PMU event counters, by setting the
+	// HPMN field of the Monitor Debug Configuration Register (EL2) to the
+	// number of counters implemented (the N field of PMCR_EL0). All other
+	// bits are 0, so PMU accesses (such as the cycle counter read by the
+	// interrupt latency benchmark) are not trapped to EL2.
+	mrs	x0, pmcr_el0
+	ubfx	x0, x0, 11, 5
+	msr	mdcr_el2, x0
+
+	// Let EL1 read the physical counter and use the physical timer, by
+	// setting the EL1PCTEN and EL1PCEN bits of the Counter-timer
+	// Hypervisor Control Register, and make the virtual counter equal
+	// to the physical counter. Each core's physical timer is driven by
+	// common/localtimer.c.
+	mov	x0, 0x3
+	msr	cnthctl_el2, x0
+	msr	cntvoff_el2, xzr
+
 	// Set the Vector Base Address Register (EL1) to the address
-	// of the vectors defined below
+	// of the vectors defined in common/vectors.s
 	adrp	x2, _vectors
 	add	x2, x2, :lo12:_vectors
 	msr     vbar_el1, x2
@@ -124,93 +160,48 @@ endloop:
 
 
 
-	// Exception handler stubs: used by the vectors below.
-
-	// A stub that does nothing	
-_synch_handler:	
-	eret
-
-
-_IRQ_handler:
-	// Save state of all general purpose registers.
-	// We do this so that any C code that we call
-	// from here can use any of the general purpose
-	// registers.
-	stp	x0, x1, [sp, -16]!
-	stp	x2, x3, [sp, -16]!
-	stp	x4, x5, [sp, -16]!
-	stp	x6, x7, [sp, -16]!
-	stp	x8, x9, [sp, -16]!
-	stp	x10, x11, [sp, -16]!
-	stp	x12, x13, [sp, -16]!
-	stp	x14, x15, [sp, -16]!
-	stp	x16, x17, [sp, -16]!
-	stp	x18, x19, [sp, -16]!
-	stp	x20, x21, [sp, -16]!
-	stp	x22, x23, [sp, -16]!
-	stp	x24, x25, [sp, -16]!
-	stp	x26, x27, [sp, -16]!
-	stp	x28, x29, [sp, -16]!
-	str	x30, [sp, -16]!
-
-	// Call the IRQ handler written in C
-	bl	IRQ_handler
-
-	// Restore state of all general purpose registers
-	ldr	x30, [sp], 16
-	ldp	x28, x29, [sp], 16
-	ldp	x26, x27, [sp], 16
-	ldp	x24, x25, [sp], 16
-	ldp	x22, x23, [sp], 16
-	ldp	x20, x21, [sp], 16
-	ldp	x18, x19, [sp], 16
-	ldp	x16, x17, [sp], 16
-	ldp	x14, x15, [sp], 16
-	ldp	x12, x13, [sp], 16
-	ldp	x10, x11, [sp], 16
-	ldp	x8, x9, [sp], 16
-	ldp	x6, x7, [sp], 16
-	ldp	x4, x5, [sp], 16
-	ldp	x2, x3, [sp], 16
-	ldp	x0, x1, [sp], 16
-
-	// Return from exception
-	eret
-	
-
-	// A stub that does nothing
-_FIQ_handler:	
-	eret
-
-	// A stub that does nothing
-_SError_handler:	
+	// The FIQ handler, used by the vectors in common/vectors.s instead
+	// of the default one that does nothing. Only one interrupt source can
+	// be routed to the FIQ (see fiq.c), so there is no dispatching: the
+	// source is System Timer compare 3, which ticks at a fixed period.
+	// The handler clears the match, moves the compare value on by one
+	// period (so the ticks do not drift when the FIQ is taken late),
+	// counts the tick, and keeps the largest delay in microseconds between
+	// the match and the handler. It is written in assembly so that it only
+	// has to save the 4 registers it uses, rather than all the registers
+	// C code may change.
+	.global	FIQ_handler
+FIQ_handler:
+	stp	x0, x1, [sp, -32]!
+	stp	x2, x3, [sp, 16]
+
+	ldr	x0, =0x3F003000		// System Timer registers
+	mov	w1, (1 << 3)
+	str	w1, [x0]		// Clear the compare 3 match in CS
+	ldr	w1, [x0, 0x04]		// Read CLO
+	ldr	w2, [x0, 0x18]		// Read C3
+	sub	w1, w1, w2		// Delay since the match
+
+	adrp	x3, fiqLateMax		// Keep the largest delay
+	ldr	w3, [x3, :lo12:fiqLateMax]
+	cmp	w1, w3
+	b.ls	1f
+	adrp	x3, fiqLateMax
+	str	w1, [x3, :lo12:fiqLateMax]
+
+1:	adrp	x3, fiqPeriod		// Set C3 to the next tick
+	ldr	w3, [x3, :lo12:fiqPeriod]
+	cmp	w1, w3			// If a whole period was missed,
+	b.lo	2f			// restart the ticks from CLO
+	add	w2, w2, w1
+2:	add	w2, w2, w3
+	str	w2, [x0, 0x18]
+
+	adrp	x3, fiqTicks		// Count the tick
+	ldr	x1, [x3, :lo12:fiqTicks]
+	add	x1, x1, 1
+	str	x1, [x3, :lo12:fiqTicks]
+
+	ldp	x2, x3, [sp, 16]
+	ldp	x0, x1, [sp], 32
 	eret
-
-
-
-	
-	// Exception Vector Table:
-	//
-	// The start of the table must be aligned to an address
-	// evenly divisible by 2048 (i.e. it must end with 11 zeroes).
-	// Furthermore, each entry must also be aligned to an
-	// address evenly divisible by 128 (i.e. must end with 7 zeroes),
-	// and entries must follow each other consecutively in memory.
-	// Each vector can be as long as 32 instructions.
-	.align 11
-_vectors:
-	// Synchronous
-	.align  7
-	b	_synch_handler	// call handler stub
-	
-	// IRQ
-	.align  7
-	b	_IRQ_handler	// call handler	stub
-
-	// FIQ
-	.align  7
-	b	_FIQ_handler	// call handler stub
-	
-	// SError
-	.align  7
-	b	_SError_handler	// call handler stub
@@ -1,3 +1,26 @@
+// The addresses of the BCM System Timer registers.
+//
+// These are defined on page 172 of the Broadcom BCM2837 ARM Peripherals
+// Manual. Note that we specify the ARM physical addresses of the
+// peripherals, which have the address range 0x3F000000 to 0x3FFFFFFF.
+// These addresses are mapped by the VideoCore Memory Management Unit (MMU)
+// onto the bus addresses in the range 0x7E000000 to 0x7EFFFFFF.
+
+#include "gpio.h"
+
+#define SYSTEM_TIMER_CS	    ((volatile unsigned int *)(MMIO_BASE + 0x00003000))
+#define SYSTEM_TIMER_CLO    ((volatile unsigned int *)(MMIO_BASE + 0x00003004))
+#define SYSTEM_TIMER_CHI    ((volatile unsigned int *)(MMIO_BASE + 0x00003008))
+#define SYSTEM_TIMER_C0     ((volatile unsigned int *)(MMIO_BASE + 0x0000300C))
+#define SYSTEM_TIMER_C1     ((volatile unsigned int *)(MMIO_BASE + 0x00003010))
+#define SYSTEM_TIMER_C2     ((volatile unsigned int *)(MMIO_BASE + 0x00003014))
+#define SYSTEM_TIMER_C3     ((volatile unsigned int *)(MMIO_BASE + 0x00003018))
+
+// Interrupt numbers of the System Timer compare channels. Channels 0 and 2
+// are used by the GPU, so only channels 1 and 3 are free for the ARM.
+#define SYSTEM_TIMER_IRQ_1  1
+#define SYSTEM_TIMER_IRQ_3  3
+
 // Function prototypes
 unsigned long get_timer_counter();
 void microsecond_delay(unsigned int interval);
@@ -0,0 +1,166 @@
+// The functions in this file let interrupt handlers defer work to the main
+// loop. A handler runs with IRQs masked, so anything slow that it does
+// (such as writing to the UART) delays the next interrupt. Instead, the
+// handler calls work_queue() with a function and an argument, and returns.
+// The main loop calls work_run(), which runs the queued functions in order
+// with interrupts enabled.
+//
+// The queue is a single-producer, single-consumer ring buffer, like the
+// GPIO event queue in gpioevent.c. Only interrupt handlers add work (they
+// never interrupt each other), and only the main loop runs it, so no locks
+// are needed. The FIQ handler must not add work, since it can interrupt an
+// IRQ handler that is adding work. The number of items waiting, the most
+// that have ever been waiting, and the number lost because the queue was
+// full are kept, so that WORK_QUEUE_SIZE can be checked.
+
+// Header files
+#include "uart.h"
+#include "workqueue.h"
+
+// Queue global variables. The head is the next slot to be written, and the
+// tail is the next slot to be read. Both only ever increase, and are masked
+// to find the slot, so the queue is empty when they are equal.
+struct work_item workQueue[WORK_QUEUE_SIZE];
+volatile unsigned int workHead;
+volatile unsigned int workTail;
+
+// Work queue statistics
+volatile unsigned int workHighWater;
+volatile unsigned int workRun;
+volatile unsigned int workDropped;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       work_queue
+//
+//  Arguments:      fn:      The function to run from the main loop
+//                  arg:     The argument to pass to it
+//
+//  Returns:        TRUE (non-zero) if the work was queued, FALSE (zero) if
+//                  the queue was full and the work was dropped.
+//
+//  Description:    This function adds a work item to the head of the queue.
+//                  It must only be called from an IRQ handler (the single
+//                  producer).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int work_queue(work_fn_t fn, unsigned long arg)
+{
+    unsigned int head = workHead;
+    unsigned int depth = head - workTail;
+    struct work_item *item;
+
+    if (depth >= WORK_QUEUE_SIZE) {
+        workDropped++;
+        return 0;
+    }
+
+    item = &workQueue[head & (WORK_QUEUE_SIZE - 1)];
+    item->fn = fn;
+    item->arg = arg;
+
+    // Make sure the item is written before it is published
+    asm volatile("dmb ish" : : : "memory");
+    workHead = head + 1;
+
+    if (depth + 1 > workHighWater) {
+        workHighWater = depth + 1;
+    }
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       work_run
+//
+//  Arguments:      max:     The largest number of items to run
+//
+//  Returns:        The number of items run.
+//
+//  Description:    This function runs up to max of the oldest work items,
+//                  in the order they were queued. It must only be called
+//                  from the main loop (the single consumer). Each slot is
+//                  released before its function runs, so a handler can
+//                  queue more work while it runs.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int work_run(int max)
+{
+    struct work_item item;
+    unsigned int tail;
+    int count = 0;
+
+    while (count < max) {
+        tail = workTail;
+        if (tail == workHead) {
+            break;
+        }
+
+        // Make sure the item is read after the head index
+        asm volatile("dmb ish" : : : "memory");
+        item = workQueue[tail & (WORK_QUEUE_SIZE - 1)];
+
+        // Make sure the item is copied before its slot is released
+        asm volatile("dmb ish" : : : "memory");
+        workTail = tail + 1;
+
+        item.fn(item.arg);
+        count++;
+    }
+
+    workRun += count;
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       work_depth
+//
+//  Arguments:      none
+//
+//  Returns:        The number of work items waiting to be run.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int work_depth()
+{
+    return workHead - workTail;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       work_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the work queue statistics to the
+//                  console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void work_report()
+{
+    uart_puts("\nWork queue report:\n");
+    uart_puts("    depth:  0x");
+    uart_puthex(work_depth());
+    uart_puts("\n    high water:  0x");
+    uart_puthex(workHighWater);
+    uart_puts("\n    run:  0x");
+    uart_puthex(workRun);
+    uart_puts("\n    dropped:  0x");
+    uart_puthex(workDropped);
+    uart_puts("\n");
+}
@@ -0,0 +1,30 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+// Definitions and function prototypes for the deferred work queue in
+// workqueue.c
+
+// Number of work items the queue can hold (must be a power of 2)
+#define WORK_QUEUE_SIZE         32
+
+// A function run later by the main loop, and the argument passed to it
+typedef void (*work_fn_t)(unsigned long arg);
+
+struct work_item {
+    work_fn_t fn;
+    unsigned long arg;
+};
+
+// Work queue statistics: the largest number of items waiting at once, the
+// number of items run, and the number lost because the queue was full
+extern volatile unsigned int workHighWater;
+extern volatile unsigned int workRun;
+extern volatile unsigned int workDropped;
+
+// Function prototypes
+int work_queue(work_fn_t fn, unsigned long arg);
+int work_run(int max);
+unsigned int work_depth();
+void work_report();
+
+#endif
@@ -1,6 +1,12 @@
 // Needed header files
 #include "uart.h"
 #include "mailbox.h"
+#include "pmu.h"
+#include "game.h"
+#include "solver.h"
+#include "history.h"
+#include "smp.h"
+#include "task.h"
 
 // HTML RGB color codes.  These can be found at:
 // https://htmlcolorcodes.com/
@@ -36,11 +42,66 @@
 #define VIRTUAL_Y_OFFSET       0
 #define PIXEL_ORDER_BGR        0     // needed for the above color codes
 
+// Maze view constants. The screen shows VIEW_ROWS x VIEW_COLS tiles of the
+// maze. The virtual frame buffer is twice as wide and twice as high as the
+// screen, and the screen is panned across it by changing the virtual
+// offset (see displayFrameBuffer()).
+#define TILE_SIZE              64    // in pixels per side
+#define VIEW_ROWS              (FRAMEBUFFER_HEIGHT / TILE_SIZE)
+#define VIEW_COLS              (FRAMEBUFFER_WIDTH / TILE_SIZE)
+#define VIRTUAL_ROWS           (2 * VIEW_ROWS)
+#define VIRTUAL_COLS           (2 * VIEW_COLS)
+#define VIRTUAL_WIDTH          (VIRTUAL_COLS * TILE_SIZE)
+#define VIRTUAL_HEIGHT         (VIRTUAL_ROWS * TILE_SIZE)
+
+// Value in shownTile for a slot that has not been drawn yet
+#define TILE_NONE              0xFF
+
 // Frame buffer global variables
 unsigned int frameBufferWidth, frameBufferHeight, frameBufferPitch;
 unsigned int frameBufferDepth, frameBufferPixelOrder, frameBufferSize;
+unsigned int virtualWidth, virtualHeight;
 unsigned int *frameBuffer;
 
+// Maze view global variables. The type of the tile drawn in every tile-sized
+// slot of the virtual frame buffer is remembered, so that a slot is only
+// drawn again when it has to show a different type. The camera is the maze
+// row and column shown in the top left corner of the screen.
+unsigned char shownTile[VIRTUAL_ROWS][VIRTUAL_COLS];
+int cameraRow = -1, cameraCol = -1;
+
+// The tiles of the hint (indices into the maze), drawn as TILE_HINT. When
+// the hint changes, the tiles of the hint last drawn are kept, so that they
+// can be drawn again without it.
+unsigned int hintTile[SOLVER_HINT_STEPS];
+int hintCount;
+unsigned int hintOldTile[SOLVER_HINT_STEPS];
+int hintOldCount;
+int hintChanged;
+
+// The color of each tile type in the maze:
+//   red = player, pink = visited, silver = path and exit, black = wall,
+//   green = exit reached, yellow = hint, and destructible walls get lighter
+//   as they lose hit points
+const unsigned int tileColor[TILE_TYPES] =
+    {
+        [TILE_PATH]     = SILVER,
+        [TILE_WALL]     = BLACK,
+        [TILE_PLAYER]   = RED,
+        [TILE_EXIT]     = SILVER,
+        [TILE_WALL_HP1] = GRAY1,
+        [TILE_WALL_HP2] = GRAY2,
+        [TILE_WALL_HP3] = GRAY3,
+        [TILE_WALL_HP4] = GRAY4,
+        [TILE_WALL_HP5] = GRAY5,
+        [TILE_VISITED]  = RED2,
+        [TILE_WON]      = GREEN,
+        [TILE_HINT]     = YELLOW
+    };
+
+// Performance counter region for drawSquare()
+int drawSquareRegion = -1;
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Function:       initFrameBuffer
@@ -76,8 +137,8 @@ void initFrameBuffer()
     mailbox_buffer[7] = TAG_SET_VIRTUAL_WIDTH_HEIGHT;
     mailbox_buffer[8] = 8;
     mailbox_buffer[9] = 8;
-    mailbox_buffer[10] = FRAMEBUFFER_WIDTH;
-    mailbox_buffer[11] = FRAMEBUFFER_HEIGHT;
+    mailbox_buffer[10] = VIRTUAL_WIDTH;
+    mailbox_buffer[11] = VIRTUAL_HEIGHT;
     
     mailbox_buffer[12] = TAG_SET_VIRTUAL_OFFSET;
     mailbox_buffer[13] = 8;
@@ -109,6 +170,9 @@ void initFrameBuffer()
 
     mailbox_buffer[34] = TAG_LAST;
 
+    // Measure the cost of drawing squares with the performance counters
+    drawSquareRegion = perf_region_create("drawSquare");
+
 
     // Make a mailbox request using the above mailbox data structure
     if (mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC)) {
@@ -121,6 +185,8 @@ void initFrameBuffer()
 	// Read the frame buffer settings from the mailbox buffer
         frameBufferWidth = mailbox_buffer[5];
         frameBufferHeight = mailbox_buffer[6];
+        virtualWidth = mailbox_buffer[10];
+        virtualHeight = mailbox_buffer[11];
         frameBufferPitch = mailbox_buffer[33];
 	frameBufferDepth = mailbox_buffer[20];
 	frameBufferPixelOrder = mailbox_buffer[24];
@@ -137,6 +203,12 @@ void initFrameBuffer()
 	uart_puthex(frameBufferHeight);
 	uart_puts(" pixels\n");
 
+	uart_puts("    virtual:     0x");
+	uart_puthex(virtualWidth);
+	uart_puts(" x 0x");
+	uart_puthex(virtualHeight);
+	uart_puts(" pixels\n");
+
 	uart_puts("    pitch:       0x");
 	uart_puthex(frameBufferPitch);
 	uart_puts(" bytes per row\n");
@@ -160,6 +232,50 @@ void initFrameBuffer()
     } else {
         uart_puts("Cannot initialize frame buffer\n");
     }
+
+    // Nothing has been drawn in the virtual frame buffer yet
+    for (int i = 0; i < VIRTUAL_ROWS; i++) {
+        for (int j = 0; j < VIRTUAL_COLS; j++) {
+            shownTile[i][j] = TILE_NONE;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       setVirtualOffset
+//
+//  Arguments:      x:     The virtual frame buffer column shown at the left
+//                         edge of the screen, in pixels
+//                  y:     The virtual frame buffer row shown at the top edge
+//                         of the screen, in pixels
+//
+//  Returns:        void
+//
+//  Description:    This function pans the screen across the virtual frame
+//                  buffer, using the mailbox request/response protocol. The
+//                  GPU does the panning, so no pixels are copied.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void setVirtualOffset(unsigned int x, unsigned int y)
+{
+    mailbox_buffer[0] = 8 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_SET_VIRTUAL_OFFSET;
+    mailbox_buffer[3] = 8;
+    mailbox_buffer[4] = 8;
+    mailbox_buffer[5] = x;
+    mailbox_buffer[6] = y;
+
+    mailbox_buffer[7] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC)) {
+        uart_puts("Cannot set virtual offset\n");
+    }
 }
 
 
@@ -180,7 +296,9 @@ void initFrameBuffer()
 //                  and it is drawn downwards and to the right on the display.
 //                  The size of the square is given in terms of pixels per side,
 //                  and the pixels in the square are given the same specified
-//                  color.
+//                  color. Squares may be drawn by any core, but only those
+//                  drawn by core 0 are measured, since each core has its own
+//                  performance counters.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -188,8 +306,14 @@ void drawSquare(int rowStart, int columnStart, int squareSize, unsigned int colo
 {
     int row, column, rowEnd, columnEnd;
     unsigned int *pixel = frameBuffer;
+    unsigned int pixelsPerRow = frameBufferPitch / 4;
+    int measured = (smp_core() == 0);
 
 
+    if (measured) {
+        perf_region_begin(drawSquareRegion);
+    }
+
     // Calculate where the row and columns end
     rowEnd = rowStart + squareSize;
     columnEnd = columnStart + squareSize;
@@ -200,9 +324,13 @@ void drawSquare(int rowStart, int columnStart, int squareSize, unsigned int colo
         for (column = columnStart; column < columnEnd; column++) {
 	    // Draw the individual pixel by setting its
 	    // RGB value in the frame buffer
-            pixel[(row * frameBufferWidth) + column] = color;
+            pixel[(row * pixelsPerRow) + column] = color;
         }
     }
+
+    if (measured) {
+        perf_region_end(drawSquareRegion);
+    }
 }
 
 
@@ -230,92 +358,308 @@ void drawCheckerboard(int numberOfRows, int numberOfColumns, int squareSize)
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       cameraStart
+//
+//  Arguments:      player:     The row (or column) of the player
+//                  size:       The number of rows (or columns) in the maze
+//                  view:       The number of rows (or columns) on the screen
+//
+//  Returns:        The first row (or column) to show, so that the player is
+//                  in the middle of the screen, but without showing anything
+//                  past the edges of the maze.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int cameraStart(int player, int size, int view)
+{
+    int start = player - view / 2;
+
+    if (start > size - view) {
+        start = size - view;
+    }
+    if (start < 0) {
+        start = 0;
+    }
+    return start;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawSlot
+//
+//  Arguments:      slotRow:     The row of the slot in the virtual frame
+//                               buffer, in tiles
+//                  slotCol:     The column of the slot, in tiles
+//                  tile:        The tile type to show in the slot
+//
+//  Returns:        void
+//
+//  Description:    This function draws a tile into a slot of the virtual
+//                  frame buffer, unless the slot already shows that type.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawSlot(int slotRow, int slotCol, unsigned char tile)
+{
+    if (shownTile[slotRow][slotCol] != tile) {
+        drawSquare(slotRow * TILE_SIZE, slotCol * TILE_SIZE, TILE_SIZE, tileColor[tile]);
+        shownTile[slotRow][slotCol] = tile;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       setHint
+//
+//  Arguments:      tiles:     The indices of the maze tiles to highlight
+//                  count:     The number of tiles (at most SOLVER_HINT_STEPS,
+//                             or 0 to hide the hint)
+//
+//  Returns:        void
+//
+//  Description:    This function sets the tiles drawn as the hint by the
+//                  next call of displayFrameBuffer(). Only path and visited
+//                  tiles are highlighted, so the player and the exit stay
+//                  visible. If the hint has changed, the tiles of both the
+//                  old and the new hint are drawn again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void setHint(const unsigned int *tiles, int count)
+{
+    int i, same;
+
+    same = (count == hintCount);
+    for (i = 0; same && (i < count); i++)
+    {
+        same = (tiles[i] == hintTile[i]);
+    }
+    if (same)
+    {
+        return;
+    }
+
+    if (!hintChanged)
+    {
+        for (i = 0; i < hintCount; i++)
+        {
+            hintOldTile[i] = hintTile[i];
+        }
+        hintOldCount = hintCount;
+        hintChanged = 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        hintTile[i] = tiles[i];
+    }
+    hintCount = count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       isHint
+//
+//  Arguments:      tile:     The index of a maze tile
+//
+//  Returns:        TRUE (non-zero) if the tile is part of the hint, FALSE
+//                  (zero) if not.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int isHint(unsigned int tile)
+{
+    int i;
+
+    for (i = 0; i < hintCount; i++)
+    {
+        if (hintTile[i] == tile)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawTile
+//
+//  Arguments:      state:     The game state to draw
+//                  i, j:      The row and column of a visible maze tile
+//
+//  Returns:        void
+//
+//  Description:    This function brings the 4 slots of a maze tile up to
+//                  date. Tiles outside the maze are shown as walls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawTile(struct game_state *state, int i, int j)
+{
+    int slotRow = i % VIEW_ROWS;
+    int slotCol = j % VIEW_COLS;
+    unsigned char tile;
+
+    if ((i < state->rows) && (j < state->cols))
+    {
+        tile = state->maze[i * state->cols + j];
+        if (hintCount && ((tile == TILE_PATH) || (tile == TILE_VISITED)) &&
+            isHint(i * state->cols + j))
+        {
+            tile = TILE_HINT;
+        }
+    }
+    else
+    {
+        tile = TILE_WALL;
+    }
+
+    drawSlot(slotRow, slotCol, tile);
+    drawSlot(slotRow, slotCol + VIEW_COLS, tile);
+    drawSlot(slotRow + VIEW_ROWS, slotCol, tile);
+    drawSlot(slotRow + VIEW_ROWS, slotCol + VIEW_COLS, tile);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawTileRow
+//
+//  Arguments:      i:         The row of a visible maze tile
+//                  state:     The game state to draw
+//
+//  Returns:        void
+//
+//  Description:    This function brings the slots of every visible tile of
+//                  a maze row up to date. It is the body of the parallel
+//                  loop in displayFrameBuffer(). The visible rows all have
+//                  different slot rows, so the rows can be drawn by
+//                  different cores at the same time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawTileRow(unsigned long i, unsigned long state)
+{
+    int j;
+
+    for (j = cameraCol; j < cameraCol + VIEW_COLS; j++)
+    {
+        drawTile((struct game_state *)state, i, j);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawChanged
+//
+//  Arguments:      state:     The game state to draw
+//                  index:     The index of a maze tile that has changed
+//
+//  Returns:        void
+//
+//  Description:    This function draws a changed tile again, if it is on
+//                  the screen.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawChanged(struct game_state *state, unsigned int index)
+{
+    int i = index / state->cols;
+    int j = index - i * state->cols;
+
+    if ((i >= cameraRow) && (i < cameraRow + VIEW_ROWS) &&
+        (j >= cameraCol) && (j < cameraCol + VIEW_COLS))
+    {
+        drawTile(state, i, j);
+    }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Function:       displayFrameBuffer
 //
-//  Arguments:      none
+//  Arguments:      state:     The game state to draw
 //
 //  Returns:        void
 //
-//  Description:    This function displays a checker board pattern, where each
-//                  square is 64 x 64 pixels in size. Since the screen
-//                  resolution is set to 1024 x 768, the board has 18 x 12
-//                  squares in total.
+//  Description:    This function displays the part of the maze around the
+//                  player. The maze can be much larger than the screen, so a
+//                  camera follows the player, and the screen is panned by
+//                  setting the virtual offset. The virtual frame buffer is
+//                  used as a wrap-around buffer: maze row r is drawn in
+//                  slot rows r % VIEW_ROWS and r % VIEW_ROWS + VIEW_ROWS,
+//                  and the same for columns, so every maze tile has up to 4
+//                  slots. Wherever the camera is, the screen then covers one
+//                  slot of every visible tile, in the right order. When the
+//                  camera moves by a tile, only the strip of tiles that comes
+//                  into view needs new pixels; every other slot already shows
+//                  the right tile type and is skipped (see drawSlot()), so
+//                  scrolling costs one strip of tiles plus one mailbox call.
+//                  While the camera stays still, only the tiles logged as
+//                  changed since the last frame (see history.c) and the
+//                  tiles of a changed hint are looked at. When every visible
+//                  tile is looked at, the rows are shared out between the
+//                  cores with parallel_for().
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void displayFrameBuffer(int maze[12][16])
+void displayFrameBuffer(struct game_state *state)
 {
-    int squareSize, numberOfRows, numberOfColumns;
-
-    // Set the size of a checker board square in terms of pixels per side. It
-    // should be a number that is a power of 2, so that it can fit cleanly into
-    // a 1024 x 768 frame buffer.
-    squareSize = 64;
-
-    // Calculate the number of rows and columns
-    numberOfRows = frameBufferHeight / squareSize;
-    numberOfColumns = frameBufferWidth / squareSize;
- 
-    // Draw a checker board pattern on the screen
-    //drawCheckerboard(numberOfRows, numberOfColumns, squareSize);
-
-    //legend 
-    //red = player
-    //green = finish point
-    //black = wall
-    //white = path
-
-    //loop thru maze array
-    for (int i = 0; i < numberOfRows; i++) 
+    const unsigned int *changed;
+    int row, col, i, count;
+
+    // Move the camera to follow the player
+    row = cameraStart(state->playerRow, state->rows, VIEW_ROWS);
+    col = cameraStart(state->playerCol, state->cols, VIEW_COLS);
+    count = history_dirty(&changed);
+
+    if ((count < 0) || (row != cameraRow) || (col != cameraCol))
     {
-        for (int j = 0; j < numberOfColumns; j++) 
+        // Bring all the slots of the visible tiles up to date, one row of
+        // tiles per task
+        cameraRow = row;
+        cameraCol = col;
+        parallel_for(row, row + VIEW_ROWS, 1, drawTileRow, (unsigned long)state);
+
+        // Pan the screen once the new tiles are drawn
+        setVirtualOffset((col % VIEW_COLS) * TILE_SIZE, (row % VIEW_ROWS) * TILE_SIZE);
+    }
+    else
+    {
+        // Only draw the tiles that changed since the last frame
+        for (i = 0; i < count; i++)
         {
-            if (maze[i][j] == 0)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, SILVER);
-            }
-            else if (maze[i][j] == 1)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, BLACK);
-            }
-            else if (maze[i][j] == 2)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, RED);
-            }
-            else if (maze[i][j] == 3)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, SILVER);
-            }
-            else if (maze[i][j] == 10)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, RED2);
-            }
-            else if (maze[i][j] == 5)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GRAY1);
-            }
-            else if (maze[i][j] == 6)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GRAY2);
-            }
-            else if (maze[i][j] == 7)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GRAY3);
-            }
-            else if (maze[i][j] == 8)
-            {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GRAY4);
-            }
-            else if (maze[i][j] == 9)
+            drawChanged(state, changed[i]);
+        }
+        if (hintChanged)
+        {
+            for (i = 0; i < hintOldCount; i++)
             {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GRAY5);
+                drawChanged(state, hintOldTile[i]);
             }
-            else if (maze[i][j] == 1337)
+            for (i = 0; i < hintCount; i++)
             {
-                drawSquare(i * squareSize, j * squareSize, squareSize, GREEN);
+                drawChanged(state, hintTile[i]);
             }
         }
     }
+
+    hintChanged = 0;
+    history_clean();
 }
@@ -1,2 +1,5 @@
+#include "game.h"
+
 void initFrameBuffer();
-void displayFrameBuffer(int maze[12][16]);
+void displayFrameBuffer(struct game_state *state);
+void setHint(const unsigned int *tiles, int count);
@@ -0,0 +1,411 @@
+// The functions in this file hold the state of the maze game: the tiles of
+// the maze, the position of the player, and whether the game has started or
+// been won. Each tile is one byte, holding its tile type, and everything
+// else about a tile is found with a single lookup in the tileInfo table.
+// The player position is kept up to date on every move, so moving, hitting
+// a wall, and detecting a win only look at the player's tile and its
+// neighbour, however large the maze is. Every change to a tile goes through
+// history.c, which logs it for undo, reset, and redraw.
+
+// Header files
+#include "uart.h"
+#include "game.h"
+#include "mazegen.h"
+#include "solver.h"
+#include "history.h"
+#include "heap.h"
+
+// The maze at the start of every game: P is a path, W a wall, D a
+// destructible wall with 5 hit points, and E the exit
+#define P   TILE_PATH
+#define W   TILE_WALL
+#define D   TILE_WALL_HP5
+#define E   TILE_EXIT
+
+const unsigned char original[12][16] =
+    {
+        {W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W},
+        {W, P, D, P, D, P, P, P, P, P, D, P, P, P, P, W},
+        {P, P, P, P, D, P, D, P, D, P, P, P, D, D, P, W},
+        {W, P, D, D, D, P, D, P, D, D, D, D, D, D, P, W},
+        {W, P, P, D, P, P, D, P, P, P, P, P, P, D, P, W},
+        {W, D, P, P, P, D, D, D, D, D, P, D, D, D, P, W},
+        {W, P, P, D, P, D, P, P, P, D, P, D, P, P, P, W},
+        {W, P, D, D, P, D, P, D, D, D, P, D, P, D, D, W},
+        {W, P, P, D, P, D, P, D, P, D, P, D, P, D, P, E},
+        {W, D, P, D, P, P, P, D, P, D, P, D, D, D, P, W},
+        {W, P, P, D, P, D, P, P, P, D, P, P, P, P, P, W},
+        {W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W}
+    };
+
+#undef P
+#undef W
+#undef D
+#undef E
+
+// The level played when the game starts, made from the maze above
+const struct game_level defaultLevel =
+    {
+        &original[0][0], 12, 16, 2, 0
+    };
+
+// The tiles of the last generated level, and the level made from them
+unsigned char generatedTiles[LEVEL_ROWS * LEVEL_COLS];
+struct game_level generatedLevel;
+
+// The algorithm used to generate the next level (MAZEGEN_*)
+int gameAlgorithm = MAZEGEN_BACKTRACKER;
+
+// Set once the tiles of the current level have been copied into the maze.
+// Until then, a reset must copy the whole level.
+int gameLoaded;
+
+// The properties of each tile type
+const struct tile_info tileInfo[TILE_TYPES] =
+    {
+        [TILE_PATH]     = {1, 0, 0, TILE_PATH},
+        [TILE_WALL]     = {0, 0, 0, TILE_WALL},
+        [TILE_PLAYER]   = {1, 0, 0, TILE_PLAYER},
+        [TILE_EXIT]     = {1, 0, 0, TILE_EXIT},
+        [TILE_WALL_HP1] = {0, 1, 1, TILE_PATH},
+        [TILE_WALL_HP2] = {0, 1, 2, TILE_WALL_HP1},
+        [TILE_WALL_HP3] = {0, 1, 3, TILE_WALL_HP2},
+        [TILE_WALL_HP4] = {0, 1, 4, TILE_WALL_HP3},
+        [TILE_WALL_HP5] = {0, 1, 5, TILE_WALL_HP4},
+        [TILE_VISITED]  = {1, 0, 0, TILE_VISITED},
+        [TILE_WON]      = {1, 0, 0, TILE_WON},
+        [TILE_HINT]     = {1, 0, 0, TILE_HINT}
+    };
+
+// The game state
+struct game_state game;
+
+// Row and column steps for each direction (indexed by DIRECTION_*)
+int directionRow[5] = {0, -1, 1, 0, 0};
+int directionCol[5] = {0, 0, 0, -1, 1};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameLoad
+//
+//  Arguments:      level:    The level to play (at most MAZE_MAX_ROWS by
+//                            MAZE_MAX_COLS tiles)
+//
+//  Returns:        void
+//
+//  Description:    This function makes the level the current one, and
+//                  resets the game to its start.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gameLoad(const struct game_level *level)
+{
+    game.level = level;
+    gameLoaded = 0;
+    gameReset();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameReset
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function resets the maze to the start of the current
+//                  level, and waits for the game to be started. The player
+//                  is not in the maze until then. If the level is already in
+//                  the maze, only the tiles changed since then are copied
+//                  back (see history_revert()), so the time taken depends on
+//                  the moves made, not on the size of the maze. Otherwise
+//                  the whole level is copied. The solver starts over unless
+//                  no wall has changed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gameReset()
+{
+    const struct game_level *level = game.level;
+    int i, walls;
+
+    walls = history_walls_changed();
+
+    if (!gameLoaded || !history_revert(level->tiles))
+    {
+        game.rows = level->rows;
+        game.cols = level->cols;
+
+        for (i = 0; i < level->rows * level->cols; i++)
+        {
+            game.maze[i] = level->tiles[i];
+        }
+
+        history_load();
+        gameLoaded = 1;
+        walls = 1;
+    }
+
+    game.playerRow = level->startRow;
+    game.playerCol = level->startCol;
+    game.started = 0;
+    game.won = 0;
+
+    if (walls)
+    {
+        solver_start();
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameGenerate
+//
+//  Arguments:      algorithm:    The maze generation algorithm (MAZEGEN_*)
+//
+//  Returns:        void
+//
+//  Description:    This function generates a new random maze, and loads it
+//                  as the current level. The maze is kept in its own buffer,
+//                  so that gameReset() can go back to its start. The scratch
+//                  memory of the generator is taken from the heap, and given
+//                  back once the maze is made. If the heap is out of memory,
+//                  the current level is kept.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gameGenerate(int algorithm)
+{
+    unsigned long size = mazegen_scratch_size(algorithm, LEVEL_ROWS, LEVEL_COLS);
+    void *scratch = heap_alloc(size);
+
+    if (scratch == 0)
+    {
+        uart_puts("Not enough memory to generate a maze\n");
+        return;
+    }
+
+    generatedLevel.tiles = generatedTiles;
+    generatedLevel.rows = LEVEL_ROWS;
+    generatedLevel.cols = LEVEL_COLS;
+    generatedLevel.startRow = mazegen(algorithm, generatedTiles, LEVEL_ROWS,
+                                      LEVEL_COLS, scratch);
+    generatedLevel.startCol = 0;
+    heap_free(scratch);
+
+    gameAlgorithm = algorithm;
+    gameLoad(&generatedLevel);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameStart
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function handles the START button. If the game is
+//                  not started yet, the player is put at the entrance of the
+//                  maze, and the moves from then on can be undone. If the
+//                  game is won, a new maze is generated for the next game,
+//                  which is started by pressing START again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gameStart()
+{
+    if (game.started == 0)
+    {
+        game.playerRow = game.level->startRow;
+        game.playerCol = game.level->startCol;
+        history_put(MAZE_INDEX(game.playerRow, game.playerCol), TILE_PLAYER);
+        history_clear();
+        game.started = 1;
+    }
+    else if (game.won == 1)
+    {
+        gameGenerate(gameAlgorithm);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameTarget
+//
+//  Arguments:      direction:    DIRECTION_UP, DOWN, LEFT, or RIGHT
+//                  row, col:     Set to the tile next to the player
+//
+//  Returns:        TRUE (non-zero) if the game is being played and the tile
+//                  next to the player is inside the maze, FALSE (zero) if not.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int gameTarget(int direction, int *row, int *col)
+{
+    if ((game.started == 0) || (game.won == 1) ||
+        (direction < DIRECTION_UP) || (direction > DIRECTION_RIGHT))
+    {
+        return 0;
+    }
+
+    *row = game.playerRow + directionRow[direction];
+    *col = game.playerCol + directionCol[direction];
+
+    return (*row >= 0) && (*row < game.rows) && (*col >= 0) && (*col < game.cols);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameMove
+//
+//  Arguments:      direction:    DIRECTION_UP, DOWN, LEFT, or RIGHT
+//
+//  Returns:        TRUE (non-zero) if the player moved, FALSE (zero) if the
+//                  way is blocked.
+//
+//  Description:    This function moves the player one tile. The tile left
+//                  behind is marked as visited, unless the player steps back
+//                  onto a visited tile, in which case the trail is erased.
+//                  Moving onto the exit wins the game. Both tile changes are
+//                  undone together.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gameMove(int direction)
+{
+    int row, col, target;
+
+    if (!gameTarget(direction, &row, &col))
+    {
+        return 0;
+    }
+
+    // walls and destructible walls block the way
+    target = MAZE_TILE(row, col);
+    if (!tileInfo[target].passable)
+    {
+        return 0;
+    }
+
+    // remove player from current position
+    history_begin();
+    if (target == TILE_VISITED)
+    {
+        history_set(MAZE_INDEX(game.playerRow, game.playerCol), TILE_PATH);
+    }
+    else
+    {
+        history_set(MAZE_INDEX(game.playerRow, game.playerCol), TILE_VISITED);
+    }
+
+    // put player in the new position
+    if (target == TILE_EXIT)
+    {
+        history_set(MAZE_INDEX(row, col), TILE_WON);
+        game.won = 1;
+    }
+    else
+    {
+        history_set(MAZE_INDEX(row, col), TILE_PLAYER);
+    }
+
+    game.playerRow = row;
+    game.playerCol = col;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameAttack
+//
+//  Arguments:      direction:    DIRECTION_UP, DOWN, LEFT, or RIGHT
+//
+//  Returns:        TRUE (non-zero) if a wall was hit, FALSE (zero) if there
+//                  is no destructible wall next to the player.
+//
+//  Description:    This function hits the destructible wall next to the
+//                  player, which takes away one hit point. A wall with one
+//                  hit point left becomes a path.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gameAttack(int direction)
+{
+    int row, col, wall;
+
+    if (!gameTarget(direction, &row, &col))
+    {
+        return 0;
+    }
+
+    wall = MAZE_TILE(row, col);
+    if (!tileInfo[wall].destructible)
+    {
+        return 0;
+    }
+
+    history_begin();
+    history_set(MAZE_INDEX(row, col), tileInfo[wall].damaged);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameUndo
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a move or hit was undone, FALSE (zero)
+//                  if there is nothing to undo.
+//
+//  Description:    This function takes back the last move or hit. A won game
+//                  can be taken back too. Moves from before the game was
+//                  started, and the oldest moves of a long game, cannot be
+//                  undone.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gameUndo()
+{
+    return history_undo();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gameRedo
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a move or hit was redone, FALSE (zero)
+//                  if there is nothing to redo.
+//
+//  Description:    This function makes again the last move or hit that was
+//                  undone. Making any other move first forgets it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int gameRedo()
+{
+    return history_redo();
+}
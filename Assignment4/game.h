@@ -0,0 +1,89 @@
+#ifndef GAME_H
+#define GAME_H
+
+// Definitions and function prototypes for the maze game state in game.c
+
+// Size of the largest maze, in tiles
+#define MAZE_MAX_ROWS   1024
+#define MAZE_MAX_COLS   1024
+
+// Size of the generated levels, in tiles. Each new game after the first is
+// played on a new random maze of this size (see mazegen.c).
+#define LEVEL_ROWS      49
+#define LEVEL_COLS      65
+
+// Tile types. Each tile of the maze is stored in one byte. A destructible
+// wall has between 1 and 5 hit points left, and each hit turns it into the
+// type with one hit point less (see tileInfo in game.c). TILE_HINT is never
+// stored in the maze; it is only drawn over the way to the exit.
+enum tile_type {
+    TILE_PATH,
+    TILE_WALL,
+    TILE_PLAYER,
+    TILE_EXIT,
+    TILE_WALL_HP1,
+    TILE_WALL_HP2,
+    TILE_WALL_HP3,
+    TILE_WALL_HP4,
+    TILE_WALL_HP5,
+    TILE_VISITED,
+    TILE_WON,
+    TILE_HINT,
+    TILE_TYPES
+};
+
+// The properties of a tile type
+struct tile_info {
+    unsigned char passable;         // the player can move onto it
+    unsigned char destructible;     // it can be hit
+    unsigned char hitPoints;        // hits left before it becomes a path
+    unsigned char damaged;          // the tile type left after one hit
+};
+
+extern const struct tile_info tileInfo[TILE_TYPES];
+
+// Directions of movement
+#define DIRECTION_UP    1
+#define DIRECTION_DOWN  2
+#define DIRECTION_LEFT  3
+#define DIRECTION_RIGHT 4
+
+// A level: the tiles of the maze at the start of a game (row by row), its
+// size, and the tile where the player enters the maze
+struct game_level {
+    const unsigned char *tiles;
+    int rows, cols;
+    int startRow, startCol;
+};
+
+// The whole state of the game. The maze can be any size up to the maximum,
+// and its tiles are stored row by row. The position of the player is kept
+// here, so that it never has to be searched for in the maze.
+struct game_state {
+    unsigned char maze[MAZE_MAX_ROWS * MAZE_MAX_COLS];
+    int rows, cols;
+    const struct game_level *level;
+    int playerRow, playerCol;
+    int started;
+    int won;
+};
+
+extern struct game_state game;
+extern const struct game_level defaultLevel;
+extern int gameAlgorithm;
+
+// The index of a row and column of the maze, and the tile there
+#define MAZE_INDEX(row, col)    ((row) * game.cols + (col))
+#define MAZE_TILE(row, col)     (game.maze[MAZE_INDEX(row, col)])
+
+// Function prototypes
+void gameLoad(const struct game_level *level);
+void gameReset();
+void gameGenerate(int algorithm);
+void gameStart();
+int gameMove(int direction);
+int gameAttack(int direction);
+int gameUndo();
+int gameRedo();
+
+#endif
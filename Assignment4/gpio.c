@@ -0,0 +1,253 @@
+// The functions in this file implement a GPIO driver that works on any
+// pin, instead of needing a separate set of functions for every pin.
+//
+// Pins are normally set up at boot with gpio_configure(), which applies a
+// whole pin-configuration table in one pass: every function select register
+// is read and written only once, and all pins that share a pull-up/down
+// setting are clocked in with a single GPPUD/GPPUDCLK0 handshake. Output
+// pins are then driven with gpio_write_mask(), which changes any number of
+// pins with one write to GPSET0 and one write to GPCLR0, and input pins are
+// read all at once with gpio_read_all().
+
+// Header files
+#include "gpio.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_wait_cycles
+//
+//  Arguments:      cycles:     The number of cycles to wait
+//
+//  Returns:        void
+//
+//  Description:    This function waits (at least) the given number of
+//                  cycles, by executing a NOP instruction in a loop. It
+//                  provides the set-up and hold times for the pull-up/down
+//                  control signal.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void gpio_wait_cycles(unsigned int cycles)
+{
+    while (cycles--) {
+        asm volatile("nop");
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_set_function
+//
+//  Arguments:      pin:          The GPIO pin number (0 - 53)
+//                  function:     The pin function (GPIO_INPUT, GPIO_OUTPUT,
+//                                or GPIO_ALT0 - GPIO_ALT5)
+//
+//  Returns:        void
+//
+//  Description:    This function sets the function of a single pin. Each
+//                  function select register holds the 3-bit fields of 10
+//                  pins, so the register is GPFSEL0 + pin / 10, and the field
+//                  starts at bit 3 * (pin % 10). The other fields in the
+//                  register are left unchanged. A pin number past 53 is
+//                  ignored.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gpio_set_function(unsigned int pin, unsigned int function)
+{
+    register unsigned int r;
+    volatile unsigned int *fsel = GPFSEL0 + (pin / 10);
+    unsigned int shift = (pin % 10) * 3;
+
+    if (pin >= GPIO_PINS) {
+        return;
+    }
+
+    r = *fsel;
+    r &= ~(0x7 << shift);
+    r |= (function & 0x7) << shift;
+    *fsel = r;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_set_pull
+//
+//  Arguments:      mask:     The bank 0 pins to change (bit n is pin n)
+//                  pull:     GPIO_PULL_NONE, GPIO_PULL_DOWN, or GPIO_PULL_UP
+//
+//  Returns:        void
+//
+//  Description:    This function sets the internal pull-up/down resistor of
+//                  all of the pins in the mask, using one handshake. We
+//                  follow the procedure outlined on page 101 of the BCM2837
+//                  ARM Peripherals manual: write the control signal to GPPUD,
+//                  wait 150 cycles, clock it into the pins with GPPUDCLK0,
+//                  wait 150 cycles, and then remove the clock. Pins that are
+//                  not in the mask keep their previous state.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gpio_set_pull(unsigned int mask, unsigned int pull)
+{
+    if (mask == 0) {
+        return;
+    }
+
+    *GPPUD = pull;
+    gpio_wait_cycles(150);
+
+    *GPPUDCLK0 = mask;
+    gpio_wait_cycles(150);
+
+    *GPPUD = GPIO_PULL_NONE;
+    *GPPUDCLK0 = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_configure
+//
+//  Arguments:      table:     An array of pin configurations
+//                  count:     The number of entries in the array
+//
+//  Returns:        void
+//
+//  Description:    This function applies a pin-configuration table in one
+//                  pass. The function select fields of all the pins are
+//                  gathered first, so that each GPFSEL register is read and
+//                  written at most once. The pins are then grouped by their
+//                  pull-up/down setting, and each group is set with a single
+//                  handshake (the hardware can only clock one setting at a
+//                  time, so a table where every pin uses the same setting
+//                  needs exactly one handshake). Finally, the rising and
+//                  falling edge detection of the input pins is enabled.
+//                  The pull and edge settings only apply to the pins of
+//                  bank 0 (pins 0 - 31); pins 32 - 53 are only given their
+//                  function. An entry with a pin number past 53 is skipped,
+//                  and a pin with a pull setting other than the GPIO_PULL_*
+//                  values keeps its current setting.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gpio_configure(struct gpio_pin_config *table, int count)
+{
+    int i;
+    unsigned int clearMask[6], setMask[6], pullMask[3];
+    unsigned int rising = 0, falling = 0, pin, bit, shift;
+    register unsigned int r;
+
+    for (i = 0; i < 6; i++) {
+        clearMask[i] = 0;
+        setMask[i] = 0;
+    }
+    for (i = 0; i < 3; i++) {
+        pullMask[i] = 0;
+    }
+
+    // Gather the function select fields, pull settings, and edges
+    for (i = 0; i < count; i++) {
+        pin = table[i].pin;
+        if (pin >= GPIO_PINS) {
+            continue;
+        }
+        shift = (pin % 10) * 3;
+
+        clearMask[pin / 10] |= (0x7 << shift);
+        setMask[pin / 10] |= (table[i].function & 0x7) << shift;
+
+        if (pin < 32) {
+            bit = 0x1 << pin;
+            if (table[i].pull <= GPIO_PULL_UP) {
+                pullMask[table[i].pull] |= bit;
+            }
+            if (table[i].edge & GPIO_EDGE_RISING) {
+                rising |= bit;
+            }
+            if (table[i].edge & GPIO_EDGE_FALLING) {
+                falling |= bit;
+            }
+        }
+    }
+
+    // Write each function select register that has changed fields
+    for (i = 0; i < 6; i++) {
+        if (clearMask[i]) {
+            r = GPFSEL0[i];
+            r &= ~clearMask[i];
+            r |= setMask[i];
+            GPFSEL0[i] = r;
+        }
+    }
+
+    // One pull-up/down handshake for each setting in use
+    gpio_set_pull(pullMask[GPIO_PULL_NONE], GPIO_PULL_NONE);
+    gpio_set_pull(pullMask[GPIO_PULL_DOWN], GPIO_PULL_DOWN);
+    gpio_set_pull(pullMask[GPIO_PULL_UP], GPIO_PULL_UP);
+
+    // Enable edge detection (p. 97 - 98 in the Broadcom manual)
+    if (rising) {
+        *GPREN0 |= rising;
+    }
+    if (falling) {
+        *GPFEN0 |= falling;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_write_mask
+//
+//  Arguments:      setMask:      The bank 0 pins to set to a 1 (high) level
+//                  clearMask:    The bank 0 pins to clear to a 0 (low) level
+//
+//  Returns:        void
+//
+//  Description:    This function changes the level of any number of output
+//                  pins, with one write to the GPIO Pin Output Set Register 0
+//                  and one write to the GPIO Pin Output Clear Register 0.
+//                  Writing a 0 bit to these registers has no effect, so pins
+//                  in neither mask keep their level.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void gpio_write_mask(unsigned int setMask, unsigned int clearMask)
+{
+    if (setMask) {
+        *GPSET0 = setMask;
+    }
+    if (clearMask) {
+        *GPCLR0 = clearMask;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpio_read_all
+//
+//  Arguments:      none
+//
+//  Returns:        The levels of all the bank 0 pins (bit n is pin n; 1 is
+//                  high and 0 is low).
+//
+//  Description:    This function reads the GPIO Pin Level Register 0, so all
+//                  32 pins are sampled at the same moment with one read.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gpio_read_all()
+{
+    return *GPLEV0;
+}
@@ -0,0 +1,43 @@
+// This file contains C functions to handle particular kinds of exceptions.
+// Only a function to handle IRQ exceptions is implemented here. The other
+// exceptions are handled by exception_handler() in common/exceptions.c.
+
+// Header files
+#include "irq.h"
+#include "systimer.h"
+#include "sample.h"
+#include "snes.h"
+#include "smp.h"
+#include "localtimer.h"
+
+// This function detects and handles the interrupts. The argument points
+// to the registers of the interrupted code, saved by the IRQ stub in
+// common/vectors.s.
+void IRQ_handler(unsigned long *frame)
+{
+    // Run the functions sent to this core by the other cores, and handle
+    // the timer of this core. The GPU interrupts are only routed to core 0.
+    smp_ipi();
+    local_timer_irq();
+    if (smp_core() != 0)
+    {
+        return;
+    }
+
+    // Handle System Timer compare channel 1, which drives the
+    // sampling profiler
+    if (*IRQ_PENDING_1 & (0x1 << SYSTEM_TIMER_IRQ_1))
+    {
+        sample_tick(frame);
+    }
+
+    // Handle System Timer compare channel 3, which drives the
+    // background reads of the SNES controller
+    if (*IRQ_PENDING_1 & (0x1 << SYSTEM_TIMER_IRQ_3))
+    {
+        snes_tick();
+    }
+
+    // Return to the IRQ exception handler stub
+    return;
+}
@@ -0,0 +1,461 @@
+// The functions in this file log every change made to the tiles of the
+// maze. Each change is a delta of 32 bits: the index of the tile (20 bits),
+// its type before and after the change (4 bits each), and a flag marking the
+// first change of a move or a hit. The deltas go into a ring buffer, so the
+// last moves can be undone and redone by writing back the types before or
+// after. When the ring is full, the oldest moves are forgotten.
+//
+// The same changes are also remembered in two other ways:
+//
+//   - Every tile changed since the maze was loaded is listed once, so the
+//     maze can be reset to the start of the level by copying back only
+//     those tiles, however large the maze is.
+//   - Every tile changed since the last frame is listed, so the display
+//     only has to look at those tiles (see displayFrameBuffer()).
+//
+// The solver is told when a change makes a tile passable or blocks it.
+
+// Header files
+#include "game.h"
+#include "solver.h"
+#include "history.h"
+
+// Fields of a delta
+#define DELTA_TILE_MASK     0x000FFFFF
+#define DELTA_BEFORE_SHIFT  20
+#define DELTA_AFTER_SHIFT   24
+#define DELTA_FIRST         0x10000000
+
+// Undo and redo global variables. The deltas from the tail to the cursor
+// can be undone, and those from the cursor to the head can be redone.
+unsigned int historyRing[HISTORY_SIZE];
+unsigned int historyTail;
+unsigned int historyCursor;
+unsigned int historyHead;
+int historyFirst;
+
+// Reset global variables: the tiles changed since the maze was loaded, a
+// bitmap of the same tiles so that each is only listed once, and the number
+// of changes between passable and blocked tiles
+unsigned int historyReset[HISTORY_RESET_SIZE];
+unsigned int historyResetCount;
+int historyResetOverflow;
+unsigned long historyResetBits[(MAZE_MAX_ROWS * MAZE_MAX_COLS) / 64];
+unsigned int historyWalls;
+
+// Redraw global variables: the tiles changed since the last frame
+unsigned int historyDirty[HISTORY_DIRTY_SIZE];
+unsigned int historyDirtyCount;
+int historyDirtyOverflow;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_load
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function is called after a whole maze has been
+//                  copied into the game state. The log is emptied, and the
+//                  whole maze must be drawn again. Only the words of the
+//                  reset bitmap that cover the maze are cleared; bits left
+//                  set past them by a larger maze are cleared by the load of
+//                  any maze that covers them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_load()
+{
+    unsigned int words = (game.rows * game.cols + 63) / 64;
+    unsigned int i;
+
+    for (i = 0; i < words; i++) {
+        historyResetBits[i] = 0;
+    }
+    historyResetCount = 0;
+    historyResetOverflow = 0;
+    historyWalls = 0;
+
+    historyDirtyCount = 0;
+    historyDirtyOverflow = 1;
+
+    history_clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_clear
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function forgets the moves that can be undone and
+//                  redone.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_clear()
+{
+    historyTail = 0;
+    historyCursor = 0;
+    historyHead = 0;
+    historyFirst = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_begin
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function marks the start of a move or a hit. The
+//                  changes logged until the next call are undone and redone
+//                  together.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_begin()
+{
+    historyFirst = 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_write
+//
+//  Arguments:      tile:      The index of the tile in the maze
+//                  value:     The new tile type
+//
+//  Returns:        void
+//
+//  Description:    This function changes a tile, and remembers it for the
+//                  reset and the redraw. If the tile changes between passable
+//                  and blocked, the solver is told: an opened wall can be
+//                  repaired in the distance field, but a new wall needs the
+//                  maze to be solved again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void history_write(unsigned int tile, unsigned char value)
+{
+    unsigned char before = game.maze[tile];
+    unsigned long bit = 0x1UL << (tile & 63);
+    int row;
+
+    game.maze[tile] = value;
+
+    if (!(historyResetBits[tile >> 6] & bit)) {
+        historyResetBits[tile >> 6] |= bit;
+        if (historyResetCount < HISTORY_RESET_SIZE) {
+            historyReset[historyResetCount++] = tile;
+        } else {
+            historyResetOverflow = 1;
+        }
+    }
+
+    if (historyDirtyCount < HISTORY_DIRTY_SIZE) {
+        historyDirty[historyDirtyCount++] = tile;
+    } else {
+        historyDirtyOverflow = 1;
+    }
+
+    if (tileInfo[before].passable != tileInfo[value].passable) {
+        historyWalls++;
+        if (tileInfo[value].passable) {
+            row = tile / game.cols;
+            solver_open(row, tile - row * game.cols);
+        } else {
+            solver_start();
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_set
+//
+//  Arguments:      tile:      The index of the tile in the maze
+//                  value:     The new tile type
+//
+//  Returns:        void
+//
+//  Description:    This function changes a tile, and logs the change so that
+//                  it can be undone. Logging a change forgets any moves that
+//                  were undone, since they can no longer be redone. If the
+//                  ring is full, the oldest move is forgotten.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_set(unsigned int tile, unsigned char value)
+{
+    unsigned int delta;
+
+    if (game.maze[tile] == value) {
+        return;
+    }
+
+    delta = tile | ((unsigned int)game.maze[tile] << DELTA_BEFORE_SHIFT) |
+            ((unsigned int)value << DELTA_AFTER_SHIFT);
+    if (historyFirst) {
+        delta |= DELTA_FIRST;
+        historyFirst = 0;
+    }
+
+    // Make room by forgetting the oldest move
+    if (historyCursor - historyTail == HISTORY_SIZE) {
+        do {
+            historyTail++;
+        } while ((historyTail != historyCursor) &&
+                 !(historyRing[historyTail & (HISTORY_SIZE - 1)] & DELTA_FIRST));
+    }
+
+    historyRing[historyCursor & (HISTORY_SIZE - 1)] = delta;
+    historyCursor++;
+    historyHead = historyCursor;
+
+    history_write(tile, value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_put
+//
+//  Arguments:      tile:      The index of the tile in the maze
+//                  value:     The new tile type
+//
+//  Returns:        void
+//
+//  Description:    This function changes a tile without logging the change
+//                  for undo. It is still undone by a reset, and redrawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_put(unsigned int tile, unsigned char value)
+{
+    if (game.maze[tile] != value) {
+        history_write(tile, value);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_apply
+//
+//  Arguments:      tile:      The index of the tile in the maze
+//                  value:     The tile type to write back
+//
+//  Returns:        void
+//
+//  Description:    This function writes back a tile type for an undo or a
+//                  redo. The player is wherever a player (or exit reached)
+//                  tile is written, so the position and whether the game is
+//                  won follow the tiles.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void history_apply(unsigned int tile, unsigned char value)
+{
+    history_write(tile, value);
+
+    if ((value == TILE_PLAYER) || (value == TILE_WON)) {
+        game.playerRow = tile / game.cols;
+        game.playerCol = tile - game.playerRow * game.cols;
+        game.won = (value == TILE_WON);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_undo
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a move was undone, FALSE (zero) if
+//                  there is nothing to undo.
+//
+//  Description:    This function undoes the changes of the last move or hit,
+//                  last change first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int history_undo()
+{
+    unsigned int delta;
+
+    if (historyCursor == historyTail) {
+        return 0;
+    }
+
+    do {
+        historyCursor--;
+        delta = historyRing[historyCursor & (HISTORY_SIZE - 1)];
+        history_apply(delta & DELTA_TILE_MASK,
+                      (delta >> DELTA_BEFORE_SHIFT) & 0xF);
+    } while (!(delta & DELTA_FIRST) && (historyCursor != historyTail));
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_redo
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a move was redone, FALSE (zero) if
+//                  there is nothing to redo.
+//
+//  Description:    This function redoes the changes of the last move or hit
+//                  that was undone, first change first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int history_redo()
+{
+    unsigned int delta;
+
+    if (historyCursor == historyHead) {
+        return 0;
+    }
+
+    do {
+        delta = historyRing[historyCursor & (HISTORY_SIZE - 1)];
+        history_apply(delta & DELTA_TILE_MASK,
+                      (delta >> DELTA_AFTER_SHIFT) & 0xF);
+        historyCursor++;
+    } while ((historyCursor != historyHead) &&
+             !(historyRing[historyCursor & (HISTORY_SIZE - 1)] & DELTA_FIRST));
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_revert
+//
+//  Arguments:      tiles:     The tiles of the maze when it was loaded
+//
+//  Returns:        TRUE (non-zero) if the maze was reset, FALSE (zero) if too
+//                  many tiles have changed, and the whole maze must be
+//                  copied again.
+//
+//  Description:    This function copies back only the tiles changed since
+//                  the maze was loaded, and forgets the moves that can be
+//                  undone and redone. The solver is not told; the caller
+//                  checks history_walls_changed() first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int history_revert(const unsigned char *tiles)
+{
+    unsigned int i, tile;
+
+    if (historyResetOverflow) {
+        return 0;
+    }
+
+    for (i = 0; i < historyResetCount; i++) {
+        tile = historyReset[i];
+        game.maze[tile] = tiles[tile];
+        historyResetBits[tile >> 6] = 0;
+
+        if (historyDirtyCount < HISTORY_DIRTY_SIZE) {
+            historyDirty[historyDirtyCount++] = tile;
+        } else {
+            historyDirtyOverflow = 1;
+        }
+    }
+    historyResetCount = 0;
+    historyWalls = 0;
+
+    history_clear();
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_walls_changed
+//
+//  Arguments:      none
+//
+//  Returns:        The number of times a tile has changed between passable
+//                  and blocked since the maze was loaded or reset.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int history_walls_changed()
+{
+    return historyWalls;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_dirty
+//
+//  Arguments:      tiles:     Set to the list of tiles changed since the
+//                             last frame
+//
+//  Returns:        The number of tiles in the list, or -1 if too many have
+//                  changed (or a new maze was loaded), and the whole view
+//                  must be checked.
+//
+//  Description:    A tile may be listed more than once.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int history_dirty(const unsigned int **tiles)
+{
+    *tiles = historyDirty;
+
+    return historyDirtyOverflow ? -1 : (int)historyDirtyCount;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       history_clean
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function empties the list of tiles changed since
+//                  the last frame. It is called once the frame is drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void history_clean()
+{
+    historyDirtyCount = 0;
+    historyDirtyOverflow = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+// Definitions and function prototypes for the tile change log in history.c
+
+// Number of tile changes kept for undo and redo (must be a power of 2)
+#define HISTORY_SIZE            4096
+
+// Number of changed tiles remembered for a fast reset of the maze
+#define HISTORY_RESET_SIZE      65536
+
+// Number of changed tiles remembered for redrawing in one frame
+#define HISTORY_DIRTY_SIZE      256
+
+// Function prototypes
+void history_load();
+void history_clear();
+void history_begin();
+void history_set(unsigned int tile, unsigned char value);
+void history_put(unsigned int tile, unsigned char value);
+int history_undo();
+int history_redo();
+int history_revert(const unsigned char *tiles);
+int history_walls_changed();
+int history_dirty(const unsigned int **tiles);
+void history_clean();
+
+#endif
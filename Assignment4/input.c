@@ -0,0 +1,375 @@
+// The functions in this file turn the raw states of the SNES controllers
+// into input events. input_update() takes the latest read made in the
+// background by the poller in snes.c, compares each controller with its
+// previous state, and queues a press event for every button that went down,
+// and a release event for every button that went up. Buttons in the repeat
+// mask that are held down also generate repeat events, after a delay and
+// then at a fixed rate. The repeats are timed from the controller
+// timestamps, not from the number of loop passes, so the game runs at the
+// same speed however long a frame takes to draw; if the loop falls behind,
+// the missed repeats are queued together (up to INPUT_MAX_REPEATS at a
+// time).
+//
+// Every event carries the timestamp of the controller read that caused it.
+// After a frame is displayed, input_displayed() records the time since the
+// oldest event handled in that frame, which gives the input-to-display
+// latency. The statistics are printed with input_report().
+//
+// The queue is a list of nodes taken from a pool, so an event is queued and
+// removed in constant time, and the pool statistics show how full the queue
+// has been.
+
+// Header files
+#include "uart.h"
+#include "systimer.h"
+#include "snes.h"
+#include "heap.h"
+#include "input.h"
+
+// Size of the event queue
+#define INPUT_QUEUE_SIZE        32
+
+// The maximum number of repeat events queued by one update for a button
+#define INPUT_MAX_REPEATS       4
+
+// A queued event, and the next (newer) one in the queue
+struct input_node {
+    struct input_event event;
+    struct input_node *next;
+};
+
+// Event queue global variables: the pool of nodes, and the oldest and newest
+// nodes of the queue. The queue is filled and emptied by the main loop only,
+// so it needs no locking.
+struct input_node inputNodes[INPUT_QUEUE_SIZE];
+struct pool inputPool;
+struct input_node *inputFirst;
+struct input_node *inputLast;
+unsigned int inputDropped;
+
+// Controller state global variables
+unsigned short inputButtons[SNES_CONTROLLERS];
+unsigned int inputSequence;
+unsigned int inputRepeatDelay;
+unsigned int inputRepeatRate;
+unsigned short inputRepeatMask;
+unsigned long inputNextRepeat[SNES_CONTROLLERS][16];
+
+// Latency global variables. The pending timestamp is that of the oldest
+// event handled since the last frame was displayed (0 if there is none).
+unsigned long inputPendingTimestamp;
+unsigned int inputLatencyCount;
+unsigned long inputLatencyTotal;
+unsigned int inputLatencyMin;
+unsigned int inputLatencyMax;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_init
+//
+//  Arguments:      repeatDelay:    The time a button must be held before it
+//                                  repeats, in microseconds
+//                  repeatRate:     The time between repeats, in microseconds
+//                  repeatMask:     The buttons that repeat (SNES_* bits)
+//
+//  Returns:        void
+//
+//  Description:    This function sets the auto-repeat timing, and empties
+//                  the event queue. The controller must be read in the
+//                  background (see snes_poll_start()). A repeat rate of 0
+//                  is taken as 1 microsecond.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void input_init(unsigned int repeatDelay, unsigned int repeatRate,
+                unsigned short repeatMask)
+{
+    int pad;
+
+    inputRepeatDelay = repeatDelay;
+    inputRepeatRate = repeatRate ? repeatRate : 1;
+    inputRepeatMask = repeatMask;
+
+    pool_init(&inputPool, inputNodes, sizeof(struct input_node), INPUT_QUEUE_SIZE);
+    inputFirst = 0;
+    inputLast = 0;
+    inputDropped = 0;
+    inputSequence = 0;
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        inputButtons[pad] = 0;
+    }
+
+    input_reset_latency();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_queue
+//
+//  Arguments:      type:         INPUT_PRESS, INPUT_RELEASE, or INPUT_REPEAT
+//                  pad:          The controller number
+//                  button:       The SNES_* bit of the button
+//                  timestamp:    The time of the controller read
+//
+//  Returns:        void
+//
+//  Description:    This function adds an event to the end of the queue. If
+//                  the pool has no free node, the event is dropped and
+//                  counted.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void input_queue(unsigned int type, int pad, unsigned short button,
+                        unsigned long timestamp)
+{
+    struct input_node *node = pool_alloc(&inputPool);
+
+    if (node == 0) {
+        inputDropped++;
+        return;
+    }
+
+    node->event.type = type;
+    node->event.pad = pad;
+    node->event.button = button;
+    node->event.state = inputButtons[pad];
+    node->event.timestamp = timestamp;
+    node->next = 0;
+
+    if (inputLast) {
+        inputLast->next = node;
+    } else {
+        inputFirst = node;
+    }
+    inputLast = node;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_update
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function takes the latest controller read, and
+//                  queues the events for every controller. Nothing is done
+//                  if there has not been a new read since the last call.
+//                  Buttons are visited with count trailing zeros, so only
+//                  the buttons that changed or are held are looked at.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void input_update()
+{
+    struct snes_sample sample;
+    unsigned int changed, held, bit, button, repeats;
+    unsigned long *nextRepeat, missed;
+    int pad;
+
+    snes_latest_sample(&sample);
+    if (sample.sequence == inputSequence) {
+        return;
+    }
+    inputSequence = sample.sequence;
+
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        changed = sample.buttons[pad] ^ inputButtons[pad];
+        inputButtons[pad] = sample.buttons[pad];
+        nextRepeat = inputNextRepeat[pad];
+
+        // Queue the presses and releases
+        while (changed) {
+            bit = __builtin_ctz(changed);
+            button = 0x1 << bit;
+            changed &= ~button;
+
+            if (sample.buttons[pad] & button) {
+                nextRepeat[bit] = sample.timestamp + inputRepeatDelay;
+                input_queue(INPUT_PRESS, pad, button, sample.timestamp);
+            } else {
+                input_queue(INPUT_RELEASE, pad, button, sample.timestamp);
+            }
+        }
+
+        // Queue the repeats of the held buttons that are due
+        held = sample.buttons[pad] & inputRepeatMask;
+        while (held) {
+            bit = __builtin_ctz(held);
+            held &= ~(0x1 << bit);
+
+            // Count the periods missed since the repeat was due, and move
+            // the next repeat past all of them at once
+            if ((long)(sample.timestamp - nextRepeat[bit]) >= 0) {
+                missed = (sample.timestamp - nextRepeat[bit]) /
+                         inputRepeatRate + 1;
+                nextRepeat[bit] += missed * inputRepeatRate;
+
+                repeats = (missed < INPUT_MAX_REPEATS) ? missed :
+                                                         INPUT_MAX_REPEATS;
+                while (repeats--) {
+                    input_queue(INPUT_REPEAT, pad, 0x1 << bit,
+                                sample.timestamp);
+                }
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_poll
+//
+//  Arguments:      event:     Where to copy the oldest event
+//
+//  Returns:        TRUE (non-zero) if an event was copied, FALSE (zero) if
+//                  the queue is empty.
+//
+//  Description:    This function removes the oldest event from the queue,
+//                  and gives its node back to the pool. The timestamp of
+//                  the first event handled in a frame is kept for the
+//                  latency statistics.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int input_poll(struct input_event *event)
+{
+    struct input_node *node = inputFirst;
+
+    if (node == 0) {
+        return 0;
+    }
+
+    *event = node->event;
+    inputFirst = node->next;
+    if (inputFirst == 0) {
+        inputLast = 0;
+    }
+    pool_free(&inputPool, node);
+
+    if (inputPendingTimestamp == 0) {
+        inputPendingTimestamp = event->timestamp;
+    }
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_state
+//
+//  Arguments:      pad:     The controller number
+//
+//  Returns:        The buttons of the controller that were pressed at the
+//                  last update (SNES_* bits).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short input_state(int pad)
+{
+    return inputButtons[pad];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_displayed
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function is called after a frame is displayed. If
+//                  any events were handled in the frame, the time from the
+//                  oldest of them to now is added to the latency statistics.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void input_displayed()
+{
+    unsigned int latency;
+
+    if (inputPendingTimestamp == 0) {
+        return;
+    }
+
+    latency = (unsigned int)(get_timer_counter() - inputPendingTimestamp);
+    inputPendingTimestamp = 0;
+
+    inputLatencyCount++;
+    inputLatencyTotal += latency;
+    if (latency < inputLatencyMin) {
+        inputLatencyMin = latency;
+    }
+    if (latency > inputLatencyMax) {
+        inputLatencyMax = latency;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_reset_latency
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function clears the latency statistics.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void input_reset_latency()
+{
+    inputPendingTimestamp = 0;
+    inputLatencyCount = 0;
+    inputLatencyTotal = 0;
+    inputLatencyMin = 0xFFFFFFFF;
+    inputLatencyMax = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       input_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the input-to-display latency
+//                  statistics (in microseconds) and the number of dropped
+//                  events to the console. All values are hexadecimal.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void input_report()
+{
+    uart_puts("\nInput latency report:\n");
+    uart_puts("    frames:  0x");
+    uart_puthex(inputLatencyCount);
+    if (inputLatencyCount) {
+        uart_puts("\n    min us:  0x");
+        uart_puthex(inputLatencyMin);
+        uart_puts("\n    mean us:  0x");
+        uart_puthex((unsigned int)(inputLatencyTotal / inputLatencyCount));
+        uart_puts("\n    max us:  0x");
+        uart_puthex(inputLatencyMax);
+    }
+    uart_puts("\n    dropped:  0x");
+    uart_puthex(inputDropped);
+    uart_puts("\n");
+}
@@ -0,0 +1,44 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+// Definitions and function prototypes for the input event layer in input.c
+
+// Header files
+#include "heap.h"
+
+// Event types
+#define INPUT_PRESS     1
+#define INPUT_RELEASE   2
+#define INPUT_REPEAT    3
+
+// Default auto-repeat timing, in microseconds: a held button repeats after
+// a quarter of a second, and then 10 times a second
+#define INPUT_DEFAULT_REPEAT_DELAY  250000
+#define INPUT_DEFAULT_REPEAT_RATE   100000
+
+// One input event. The pad is the number of the controller, the button is
+// one of the SNES_* bits in snes.h, and the state holds all of the buttons
+// of that controller that were pressed when the event happened. The
+// timestamp is the System Timer count when the controller was read.
+struct input_event {
+    unsigned short type;
+    unsigned short pad;
+    unsigned short button;
+    unsigned short state;
+    unsigned long timestamp;
+};
+
+// The pool of the nodes of the event queue, for its statistics
+extern struct pool inputPool;
+
+// Function prototypes
+void input_init(unsigned int repeatDelay, unsigned int repeatRate,
+                unsigned short repeatMask);
+void input_update();
+int input_poll(struct input_event *event);
+unsigned short input_state(int pad);
+void input_displayed();
+void input_report();
+void input_reset_latency();
+
+#endif
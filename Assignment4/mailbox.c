@@ -1,4 +1,6 @@
 #include "gpio.h"
+#include "mmu.h"
+#include "mailbox.h"
 
 // Define mailbox registers. These can be found at:
 // https://github.com/raspberrypi/firmware/wiki/Mailboxes
@@ -53,6 +55,9 @@ volatile unsigned int  __attribute__((aligned(16))) mailbox_buffer[36];
 //                  able to reply with a valid response. If so, we return
 //                  a TRUE to calling code, which then can read the response
 //                  in particular fields withing the global mailbox buffer.
+//                  The video core does not look at the ARM data caches, so
+//                  the buffer is cleaned to memory before the request is
+//                  sent, and again before the response is read.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -64,6 +69,9 @@ int mailbox_query(unsigned char channel)
     address = (unsigned int)((unsigned long)&mailbox_buffer[0]) & 0xFFFFFFF0;
     address |= (channel & 0xF);
 
+    // Make sure the video core sees the request
+    mmu_clean(mailbox_buffer, sizeof(mailbox_buffer));
+
     // Keep polling mailbox 1 until it can accept a request
     while (*MAILBOX1_STATUS & MAILBOX_FULL)
 	;
@@ -80,6 +88,9 @@ int mailbox_query(unsigned char channel)
         // Make sure it is a response to our original request,
 	// otherwise keep waiting for a response
         if (*MAILBOX0_READ == address) {
+            // Drop any cached copy of the buffer, so the response is read
+            mmu_clean(mailbox_buffer, sizeof(mailbox_buffer));
+
             // Return TRUE if is it a valid response, otherwise return FALSE
             return (mailbox_buffer[1] == MAILBOX_RESPONSE);
 	}
@@ -88,3 +99,45 @@ int mailbox_query(unsigned char channel)
     // We should never arrive here, but if we do, return FALSE (invalid message)
     return 0;
 }
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mailbox_arm_memory
+//
+//  Arguments:      base:     Where to copy the start of the ARM memory
+//                  size:     Where to copy the size of the ARM memory
+//
+//  Returns:        TRUE (non-zero) if the video core answered the query,
+//                  FALSE (zero) otherwise.
+//
+//  Description:    This function asks the video core which part of the RAM
+//                  is given to the ARM cores. The rest, up to the
+//                  peripherals, is used by the video core (for example for
+//                  the frame buffer).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int mailbox_arm_memory(unsigned int *base, unsigned int *size)
+{
+    mailbox_buffer[0] = 8 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_GET_ARM_MEMORY;
+    mailbox_buffer[3] = 8;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = 0;    // Response: Base address
+    mailbox_buffer[6] = 0;    // Response: Size
+
+    mailbox_buffer[7] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC)) {
+        return 0;
+    }
+
+    *base = mailbox_buffer[5];
+    *size = mailbox_buffer[6];
+
+    return 1;
+}
@@ -137,5 +137,6 @@
 // It is allocated in mailbox.c
 extern volatile unsigned int mailbox_buffer[36];
 
-// Function prototype
+// Function prototypes
 int mailbox_query(unsigned char channel);
+int mailbox_arm_memory(unsigned int *base, unsigned int *size);
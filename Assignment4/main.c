@@ -7,93 +7,55 @@
 #include "framebuffer.h"
 #include "gpio.h"
 #include "systimer.h"
-
-// Function prototypes
-unsigned short get_SNES();
-void init_GPIO9_to_output();
-void set_GPIO9();
-void clear_GPIO9();
-void init_GPIO11_to_output();
-void set_GPIO11();
-void clear_GPIO11();
-void init_GPIO10_to_input();
-unsigned int get_GPIO10();
-
-/*
-maze legend:
-    0 = path
-    1 = wall
-    2 = player
-    3 = exit
-*/
-int maze[12][16] = 
+#include "profile.h"
+#include "sample.h"
+#include "sysreg.h"
+#include "pmu.h"
+#include "snes.h"
+#include "input.h"
+#include "game.h"
+#include "rng.h"
+#include "mazegen.h"
+#include "solver.h"
+#include "smp.h"
+#include "mailbox.h"
+#include "mmu.h"
+#include "sync.h"
+#include "task.h"
+#include "heap.h"
+
+//my input and debug console functions
+int buttonDirection(unsigned short button);
+void handleConsole();
+void pingCores();
+
+//events counted in the performance counter regions
+unsigned int perfEvents[] =
     {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 
-        {1, 0, 9, 0, 9, 0, 0, 0, 0, 0, 9, 0, 0, 0, 0, 1},
-        {0, 0, 0, 0, 9, 0, 9, 0, 9, 0, 0, 0, 9, 9, 0, 1},
-        {1, 0, 9, 9, 9, 0, 9, 0, 9, 9, 9, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 0, 9, 0, 0, 0, 0, 0, 0, 9, 0, 1},
-        {1, 9, 0, 0, 0, 9, 9, 9, 9, 9, 0, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 9, 0, 0, 0, 9, 0, 9, 0, 0, 0, 1},
-        {1, 0, 9, 9, 0, 9, 0, 9, 9, 9, 0, 9, 0, 9, 9, 1},
-        {1, 0, 0, 9, 0, 9, 0, 9, 0, 9, 0, 9, 0, 9, 0, 3},
-        {1, 9, 0, 9, 0, 0, 0, 9, 0, 9, 0, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 9, 0, 0, 0, 9, 0, 0, 0, 0, 0, 1},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
+        PMU_EVENT_INST_RETIRED,
+        PMU_EVENT_L1D_CACHE_REFILL,
+        PMU_EVENT_L2D_CACHE_REFILL,
+        PMU_EVENT_L1D_TLB_REFILL,
+        PMU_EVENT_BR_MIS_PRED,
+        PMU_EVENT_BUS_ACCESS
     };
 
-int original[12][16] = 
-    {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 
-        {1, 0, 9, 0, 9, 0, 0, 0, 0, 0, 9, 0, 0, 0, 0, 1},
-        {0, 0, 0, 0, 9, 0, 9, 0, 9, 0, 0, 0, 9, 9, 0, 1},
-        {1, 0, 9, 9, 9, 0, 9, 0, 9, 9, 9, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 0, 9, 0, 0, 0, 0, 0, 0, 9, 0, 1},
-        {1, 9, 0, 0, 0, 9, 9, 9, 9, 9, 0, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 9, 0, 0, 0, 9, 0, 9, 0, 0, 0, 1},
-        {1, 0, 9, 9, 0, 9, 0, 9, 9, 9, 0, 9, 0, 9, 9, 1},
-        {1, 0, 0, 9, 0, 9, 0, 9, 0, 9, 0, 9, 0, 9, 0, 3},
-        {1, 9, 0, 9, 0, 0, 0, 9, 0, 9, 0, 9, 9, 9, 0, 1},
-        {1, 0, 0, 9, 0, 9, 0, 0, 0, 9, 0, 0, 0, 0, 0, 1},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
-    };
-
-//my maze functions
-int getRow();
-int getCol();
-void move(int choice);
-void move2(int choice);
-int moveValid(int playerRow, int playerCol);
-int hitWall(int currentHp);
-int isDestructable(int wall);
-void newGame();
-
-//flags
-int gameStarted = 0;
-int gameWon = 0;
-
 // starting point of program
 void main()
 {
-    unsigned short data, currentState = 0xFFFF;
+    unsigned short currentState[SNES_CONTROLLERS];
+    struct input_event event;
+    unsigned int hint[SOLVER_HINT_STEPS];
+    int pad, direction, hintOn;
+    int snesRegion, renderRegion, solverRegion;
+    unsigned int core, memoryBase, memorySize;
+    unsigned long frameMark;
 
     // Set up the UART serial port
     uart_init();
     
-    // Set up GPIO pin #9 for output (LATCH output)
-    init_GPIO9_to_output();
-    
-    // Set up GPIO pin #11 for output (CLOCK output)
-    init_GPIO11_to_output();
-    
-    // Set up GPIO pin #10 for input (DATA input)
-    init_GPIO10_to_input();
-    
-    // Clear the LATCH line (GPIO 9) to low
-    clear_GPIO9();
-    
-    // Set CLOCK line (GPIO 11) to high
-    set_GPIO11();
+    // Set up the pins of the SNES controller (see snes.c)
+    snes_init();
     
     // Print out a message to the console
     uart_puts("SNES Controller Program starting.\n");
@@ -103,769 +65,279 @@ void main()
     // Initialize the UART terminal
     uart_init();
 
-    // Initialize the frame buffer
-    initFrameBuffer();
-
-    // Loop forever, echoing characters received from the console
-    // on a separate line with : : around the character
-    while (1) 
+    // Turn on the MMU and the caches. Only the RAM given to the ARM cores is
+    // cached, since the video core reads the frame buffer from the rest.
+    // The RAM after the kernel image, up to the end of the ARM memory, is
+    // the heap.
+    if (mailbox_arm_memory(&memoryBase, &memorySize))
     {
-        // Read data from the SNES controller
-        data = get_SNES();
+        mmu_init((unsigned long)memoryBase + memorySize);
+        heap_init((unsigned long)memoryBase + memorySize);
+    }
+    else
+    {
+        uart_puts("ARM memory query failed, the MMU is off\n");
+        heap_init(HEAP_DEFAULT_END);
+    }
 
-        // Write out data if the state of the controller has changed
-        if (data != currentState) 
-        {
-            // Write the data out to the console in hexadecimal
-            uart_puts("0x");
-            uart_puthex(data);
-            uart_puts("\n");
+    // Start the performance counters, and create the regions to measure
+    pmu_init();
+    pmu_select_events(perfEvents, sizeof(perfEvents) / sizeof(perfEvents[0]));
+    snesRegion = perf_region_create("input_update");
+    renderRegion = perf_region_create("displayFrameBuffer");
+    solverRegion = perf_region_create("solver_update");
 
-            // Record the state of the controller
-            currentState = data;
-        }
+    // Seed the random number generator from the hardware generator, so
+    // that every boot plays different mazes
+    rng_seed(((unsigned long)rng_hardware() << 32) | rng_hardware());
+
+    // Initialize the frame buffer, and set up the maze. The first game is
+    // played on the original maze, and later ones on generated mazes.
+    initFrameBuffer();
+    gameLoad(&defaultLevel);
 
-        /*
-            SNES controller input
+#ifdef PROFILE
+    // Start recording the function-level profile
+    profile_init();
+#endif
 
-            a      - 0x00000100
-            b      - 0x00000001
-            x      - 0x00000200
-            y      - 0x00000002
+    // Start the sampling profiler, which is driven by a timer interrupt
+    sample_start(SAMPLE_DEFAULT_INTERVAL);
+
+    // Read the SNES controller in the background, driven by another
+    // timer interrupt
+    snes_poll_start(SNES_DEFAULT_POLL_INTERVAL);
+    enableIRQ();
+
+    // Start the other cores, which run tasks (see task.c) and wait for
+    // calls from smp_call()
+    for (core = 1; core < SMP_CORES; core++)
+    {
+        smp_start(core, task_worker, 0);
+    }
 
-            up     - 0x00000010
-            down   - 0x00000020
-            left   - 0x00000040
-            right  - 0x00000080
+    // Turn the controller reads into events. Only the direction buttons
+    // repeat when held down.
+    input_init(INPUT_DEFAULT_REPEAT_DELAY, INPUT_DEFAULT_REPEAT_RATE,
+               SNES_DPAD);
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++)
+    {
+        currentState[pad] = 0xFFFF;
+    }
+    hintOn = 0;
 
-            start  - 0x00000008
-            select - 0x00000004
+    // Everything taken from the frame arena is given back on every pass
+    frameMark = arena_mark(&heapFrameArena);
 
-            bonus:
+    // Loop forever, echoing characters received from the console
+    // on a separate line with : : around the character
+    while (1) 
+    {
+        arena_reset(&heapFrameArena, frameMark);
 
-            x up   - 0x00000210
-            x down - 0x00000220
-            x left - 0x00000240
-            x right- 0x00000280
-        */
+        // Turn the latest state of the SNES controller, read in the
+        // background by the interrupt handler, into input events
+        perf_region_begin(snesRegion);
+        input_update();
+        perf_region_end(snesRegion);
 
-        //up
-        if ((data == 0x00000010) && (gameStarted == 1) && (gameWon == 0))
+        // Write out data if the state of a controller has changed
+        for (pad = 0; pad < SNES_CONTROLLERS; pad++)
         {
-            if (maze[getRow()-1][getCol()] == 10)
+            if (input_state(pad) != currentState[pad]) 
             {
-                move2(1);
-            }
-            else
-            {
-                move(1);
+                // Write the controller number and the data out to the
+                // console in hexadecimal
+                uart_puthex(pad);
+                uart_puts(": 0x");
+                uart_puthex(input_state(pad));
+                uart_puts("\n");
+
+                // Record the state of the controller
+                currentState[pad] = input_state(pad);
             }
         }
-        //down
-        else if ((data == 0x00000020) && (gameStarted == 1) && (gameWon == 0))
+
+        // Handle each press and repeat of a button once. Holding a
+        // direction repeats the move at the auto-repeat rate, so the player
+        // moves at the same speed however long a frame takes to draw. Any
+        // of the controllers can move the player.
+        while (input_poll(&event))
         {
-            if (maze[getRow()+1][getCol()] == 10)
+            if (event.type == INPUT_RELEASE)
             {
-                move2(2);
+                continue;
             }
-            else
+
+            //directions move the player, or hit a wall while X is held down
+            if (event.button & SNES_DPAD)
             {
-                move(2);
+                direction = buttonDirection(event.button);
+                if (event.state & SNES_X)
+                {
+                    gameAttack(direction);
+                }
+                else
+                {
+                    gameMove(direction);
+                }
             }
-        }
-        //left
-        else if ((data == 0x00000040) && (gameStarted == 1) && (gameWon == 0))
-        {
-            if (maze[getRow()][getCol()-1] == 10)
+            //start (or restart once the game is won)
+            else if (event.button == SNES_START)
             {
-                move2(3);
+                gameStart();
             }
-            else
+            //L takes back the last move or hit, and R makes it again
+            else if (event.button == SNES_L)
             {
-                move(3);
+                gameUndo();
             }
-        }
-        //right
-        else if ((data == 0x00000080) && (gameStarted == 1) && (gameWon == 0))
-        {
-            if (maze[getRow()][getCol()+1] == 10)
+            else if (event.button == SNES_R)
             {
-                move2(4);
+                gameRedo();
             }
-            else
+            //select shows or hides the way to the exit
+            else if (event.button == SNES_SELECT)
             {
-                move(4);
+                hintOn = !hintOn;
             }
         }
-        //destroy up
-        else if ((data == 0x00000210) && (gameStarted == 1) && (gameWon == 0) && (isDestructable(maze[getRow()-1][getCol()]) == 1))
-        {
-            maze[getRow()-1][getCol()] = hitWall(maze[getRow()-1][getCol()]);
-        }
-        //destroy down
-        else if ((data == 0x00000220) && (gameStarted == 1) && (gameWon == 0) && (isDestructable(maze[getRow()+1][getCol()]) == 1))
-        {
-            maze[getRow()+1][getCol()] = hitWall(maze[getRow()+1][getCol()]);
-        }
-        //destroy right
-        else if ((data == 0x00000280) && (gameStarted == 1) && (gameWon == 0) && (isDestructable(maze[getRow()][getCol()+1]) == 1))
+
+        // Work on the solution of the maze for part of the frame, and show
+        // the next steps from the player if the hint is on
+        perf_region_begin(solverRegion);
+        solver_update(SOLVER_FRAME_BUDGET);
+        if (hintOn)
         {
-            maze[getRow()][getCol()+1] = hitWall(maze[getRow()][getCol()+1]);
+            setHint(hint, solver_path(game.playerRow, game.playerCol, hint, SOLVER_HINT_STEPS));
         }
-        //destroy left
-        else if ((data == 0x00000240) && (gameStarted == 1) && (gameWon == 0) && (isDestructable(maze[getRow()][getCol()-1]) == 1))
+        else
         {
-            maze[getRow()][getCol()-1] = hitWall(maze[getRow()][getCol()-1]);
-        }
-        //start
-        else if (data == 0x00000008)
-        {
-            //if game is not started yet, start the game
-            if (gameStarted == 0)
-            {
-                //loads player to starting location
-                maze[2][0] = 2;
-                gameStarted = 1;
-            }
-            //if game is won, restart the game
-            if (gameWon == 1)
-            {
-                //clears player off the exit
-                maze[8][15] = 3;
-                gameStarted = 0;
-                gameWon = 0;
-                newGame();
-            }
+            setHint(hint, 0);
         }
+        perf_region_end(solverRegion);
 
         // Draw on the frame buffer and display it
-        displayFrameBuffer(maze);
+        perf_region_begin(renderRegion);
+        displayFrameBuffer(&game);
+        perf_region_end(renderRegion);
+        input_displayed();
+
+        // Handle any debug command typed on the console
+        handleConsole();
 
         // Delay 
         microsecond_delay(1);
     }
 }
 
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       get_SNES
-//
-//  Arguments:      none
-//
-//  Returns:        A short integer with the button presses encoded with 16
-//                  bits. 1 means pressed, and 0 means unpressed. Bit 0 is
-//                  button B, Bit 1 is button Y, etc. up to Bit 11, which is
-//                  button R. Bits 12-15 are always 0.
-//
-//  Description:    This function samples the button presses on the SNES
-//                  controller, and returns an encoding of these in a 16-bit
-//                  integer. We assume that the CLOCK output is already high,
-//                  and set the LATCH output to high for 12 microseconds. This
-//                  causes the controller to latch the values of the button
-//                  presses into its internal register. We then clock this data
-//                  to the CPU over the DATA line in a serial fashion, by
-//                  pulsing the CLOCK line low 16 times. We read the data on
-//                  the falling edge of the clock. The rising edge of the clock
-//                  causes the controller to output the next bit of serial data
-//                  to be place on the DATA line. The clock cycle is 12
-//                  microseconds long, so the clock is low for 6 microseconds,
-//                  and then high for 6 microseconds. 
-//
-////////////////////////////////////////////////////////////////////////////////
-
-unsigned short get_SNES()
-{
-    int i;
-    unsigned short data = 0;
-    unsigned int value;
-	
-	
-    // Set LATCH to high for 12 microseconds. This causes the controller to
-    // latch the values of button presses into its internal register. The
-    // first serial bit also becomes available on the DATA line.
-    set_GPIO9();
-    microsecond_delay(12);
-    clear_GPIO9();
-	
-    // Output 16 clock pulses, and read 16 bits of serial data
-    for (i = 0; i < 16; i++) {
-	// Delay 6 microseconds (half a cycle)
-	microsecond_delay(6);
-		
-	// Clear the CLOCK line (creates a falling edge)
-	clear_GPIO11();
-		
-	// Read the value on the input DATA line
-	value = get_GPIO10();
-		
-	// Store the bit read. Note we convert a 0 (which indicates a button
-	// press) to a 1 in the returned 16-bit integer. Unpressed buttons
-	// will be encoded as a 0.
-	if (value == 0) {
-	    data |= (0x1 << i);
-	}
-		
-	// Delay 6 microseconds (half a cycle)
-	microsecond_delay(6);
-		
-	// Set the CLOCK to 1 (creates a rising edge). This causes the
-	// controller to output the next bit, which we read half a
-	// cycle later.
-	set_GPIO11();
-    }
-	
-    // Return the encoded data
-    return data;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       init_GPIO9_to_output
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function sets GPIO pin 9 to an output pin without
-//                  any pull-up or pull-down resistors.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void init_GPIO9_to_output()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 0
-    r = *GPFSEL0;
-
-    // Clear bits 27 - 29. This is the field FSEL9, which maps to GPIO pin 9.
-    // We clear the bits by ANDing with a 000 bit pattern in the field.
-    r &= ~(0x7 << 27);
-
-    // Set the field FSEL9 to 001, which sets pin 9 to an output pin.
-    // We do so by ORing the bit pattern 001 into the field.
-    r |= (0x1 << 27);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 0
-    *GPFSEL0 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 9. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. The
-    // internal pull-up and pull-down resistor isn't needed for an output pin.
-
-    // Disable pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-	asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 9 to
-    // clock in the control signal for GPIO pin 9. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 9);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       set_GPIO9
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function sets the GPIO output pin 9
-//                  to a 1 (high) level.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void set_GPIO9()
-{
-    register unsigned int r;
-	  
-    // Put a 1 into the SET9 field of the GPIO Pin Output Set Register 0
-    r = (0x1 << 9);
-    *GPSET0 = r;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       clear_GPIO9
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function clears the GPIO output pin 9
-//                  to a 0 (low) level.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void clear_GPIO9()
-{
-    register unsigned int r;
-	  
-    // Put a 1 into the CLR9 field of the GPIO Pin Output Clear Register 0
-    r = (0x1 << 9);
-    *GPCLR0 = r;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       init_GPIO11_to_output
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function sets GPIO pin 11 to an output pin without
-//                  any pull-up or pull-down resistors.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void init_GPIO11_to_output()
-{
-    register unsigned int r;
-    
-    // Get the current contents of the GPIO Function Select Register 1
-    r = *GPFSEL1;
-
-    // Clear bits 3 - 5. This is the field FSEL11, which maps to GPIO pin 11.
-    // We clear the bits by ANDing with a 000 bit pattern in the field.
-    r &= ~(0x7 << 3);
-
-    // Set the field FSEL11 to 001, which sets pin 9 to an output pin.
-    // We do so by ORing the bit pattern 001 into the field.
-    r |= (0x1 << 3);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 1
-    *GPFSEL1 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 11. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. The
-    // internal pull-up and pull-down resistor isn't needed for an output pin.
-
-    // Disable pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-	asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 11 to
-    // clock in the control signal for GPIO pin 11. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 11);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       set_GPIO11
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function sets the GPIO output pin 11
-//                  to a 1 (high) level.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void set_GPIO11()
-{
-    register unsigned int r;
-	  
-    // Put a 1 into the SET11 field of the GPIO Pin Output Set Register 0
-    r = (0x1 << 11);
-    *GPSET0 = r;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       clear_GPIO11
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function clears the GPIO output pin 11
-//                  to a 0 (low) level.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void clear_GPIO11()
-{
-    register unsigned int r;
-	  
-    // Put a 1 into the CLR11 field of the GPIO Pin Output Clear Register 0
-    r = (0x1 << 11);
-    *GPCLR0 = r;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       init_GPIO10_to_input
-//
-//  Arguments:      none
-//
-//  Returns:        void
-//
-//  Description:    This function sets GPIO pin 10 to an input pin without
-//                  any internal pull-up or pull-down resistors. Note that
-//                  a pull-down (or pull-up) resistor must be used externally
-//                  on the bread board circuit connected to the pin. Be sure
-//                  that the pin high level is 3.3V (definitely NOT 5V).
-//
-////////////////////////////////////////////////////////////////////////////////
-
-void init_GPIO10_to_input()
-{
-    register unsigned int r;
-    
-    
-    // Get the current contents of the GPIO Function Select Register 1
-    r = *GPFSEL1;
-
-    // Clear bits 0 - 2. This is the field FSEL10, which maps to GPIO pin 10.
-    // We clear the bits by ANDing with a 000 bit pattern in the field. This
-    // sets the pin to be an input pin.
-    r &= ~(0x7 << 0);
-
-    // Write the modified bit pattern back to the
-    // GPIO Function Select Register 1
-    *GPFSEL1 = r;
-
-    // Disable the pull-up/pull-down control line for GPIO pin 10. We follow the
-    // procedure outlined on page 101 of the BCM2837 ARM Peripherals manual. We
-    // will pull down the pin using an external resistor connected to ground.
-
-    // Disable internal pull-up/pull-down by setting bits 0:1
-    // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
-
-    // Wait 150 cycles to provide the required set-up time 
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Write to the GPIO Pull-Up/Down Clock Register 0, using a 1 on bit 10 to
-    // clock in the control signal for GPIO pin 10. Note that all other pins
-    // will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 10);
-
-    // Wait 150 cycles to provide the required hold time
-    // for the control signal
-    r = 150;
-    while (r--) {
-        asm volatile("nop");
-    }
-
-    // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
-    // in order to remove the clock
-    *GPPUDCLK0 = 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-//
-//  Function:       get_GPIO10
-//
-//  Arguments:      none
-//
-//  Returns:        1 if the pin level is high, and 0 if the pin level is low.
-//
-//  Description:    This function gets the current value of pin 10.
-//
-////////////////////////////////////////////////////////////////////////////////
-
-unsigned int get_GPIO10()
-{
-    register unsigned int r;
-	  
-	  
-    // Get the current contents of theminicom -b 115200 -D /dev/ttyUSB0GPIO Pin Level Register 0
-    r = *GPLEV0;
-	  
-    // Isolate pin 10, and return its minicom -b 115200 -D /dev/ttyUSB0alue (a 0 if low, or a 1 if high)
-    return ((r >> 10) & 0x1);
-}
-
-/**
- * This method returns the row index of the player
- */
-int getRow()
-{
-    int playerRow = 0;
-    for (int row = 0; row<12; row++)
-    {
-            for (int col = 0; col<16; col++)
-            {
-                if (maze[row][col] == 2)
-                {
-                    playerRow = row;
-                }
-            } 
-    }
-    return playerRow;
-}
-/**
- * This method returns the column index of the player
- */
-int getCol()
+//converts a direction button to a direction of movement
+int buttonDirection(unsigned short button)
 {
-    int playerCol = 0;
-    for (int row = 0; row<12; row++)
+    switch (button)
     {
-            for (int col = 0; col<16; col++)
-            {
-                if (maze[row][col] == 2)
-                {
-                    playerCol = col;
-                }
-            } 
+        case SNES_UP:
+            return DIRECTION_UP;
+        case SNES_DOWN:
+            return DIRECTION_DOWN;
+        case SNES_LEFT:
+            return DIRECTION_LEFT;
+        default:
+            return DIRECTION_RIGHT;
     }
-    return playerCol;
 }
-/**
- * This method moves the player on the grid
- */
-void move(int choice)
+//handles single character debug commands typed on the console
+void handleConsole()
 {
-    int playerRow = getRow();
-    int playerCol = getCol();
-
-    // remove player from current position
-    maze[playerRow][playerCol] = 10;
-
-
-    //up
-    if (choice == 1)
+    if (!uart_rx_ready())
     {
-        playerRow -= 1;
+        return;
     }
-    //down
-    else if (choice == 2)
-    {
-        playerRow += 1;
-    }
-    //left
-    else if (choice == 3)
-    {
-        playerCol -= 1;
-    }
-    //right
-    else if (choice == 4)
-    {
-        playerCol += 1;
-    }
-
-    //if this new maze[r][c] is pink, leave that old one as white
-    //else
 
-    // sets player to new position if move is valid
-    if (moveValid(playerRow, playerCol) == 1)
+    switch (uart_getc())
     {
-        if (maze[playerRow][playerCol] == 3)
-        {
-            maze[playerRow][playerCol] = 1337;
-            gameWon = 1;
-        }
-        else
-        {
-            maze[playerRow][playerCol] = 2;
-        }
-    }
-    else // player does not move, returns to origin
-    {
-        //up
-        if (choice == 1)
-        {
-            playerRow += 1;
-        }
-        //down
-        else if (choice == 2)
-        {
-            playerRow -= 1;
-        }
-        //left
-        else if (choice == 3)
-        {
-            playerCol += 1;
-        }
-        //right
-        else if (choice == 4)
-        {
-            playerCol -= 1;
-        }
-        maze[playerRow][playerCol] = 2;	
-    }
-}
-/**
- * This method moves the player on the grid
- */
-void move2(int choice)
-{
-    int playerRow = getRow();
-    int playerCol = getCol();
-
-    // remove player from current position
-    maze[playerRow][playerCol] = 0;
-
-
-    //up
-    if (choice == 1)
-    {
-        playerRow -= 1;
-    }
-    //down
-    else if (choice == 2)
-    {
-        playerRow += 1;
-    }
-    //left
-    else if (choice == 3)
-    {
-        playerCol -= 1;
-    }
-    //right
-    else if (choice == 4)
-    {
-        playerCol += 1;
-    }
-
-    //if this new maze[r][c] is pink, leave that old one as white
-    //else
-
-    // sets player to new position if move is valid
-    if (moveValid(playerRow, playerCol) == 1)
-    {
-        if (maze[playerRow][playerCol] == 3)
-        {
-            maze[playerRow][playerCol] = 1337;
-            gameWon = 1;
-        }
-        else
-        {
-            maze[playerRow][playerCol] = 2;
-        }
-    }
-    else // player does not move, returns to origin
-    {
-        //up
-        if (choice == 1)
-        {
-            playerRow += 1;
-        }
-        //down
-        else if (choice == 2)
-        {
-            playerRow -= 1;
-        }
-        //left
-        else if (choice == 3)
-        {
-            playerCol += 1;
-        }
-        //right
-        else if (choice == 4)
-        {
-            playerCol -= 1;
-        }
-        maze[playerRow][playerCol] = 2;	
+#ifdef PROFILE
+        //dump the function-level profile
+        case 'p':
+            profile_dump();
+            break;
+        //start a new function-level profile
+        case 'P':
+            profile_reset();
+            break;
+#endif
+        //print the performance counter report
+        case 'r':
+            perf_report();
+            break;
+        //clear the performance counter totals
+        case 'R':
+            perf_region_reset();
+            break;
+        //export the sampling profiler histogram
+        case 's':
+            sample_export();
+            break;
+        //clear the sampling profiler histogram
+        case 'S':
+            sample_reset();
+            break;
+        //print the input latency report
+        case 'i':
+            input_report();
+            break;
+        //clear the input latency statistics
+        case 'I':
+            input_reset_latency();
+            break;
+        //generate a new maze with the next algorithm
+        case 'g':
+            gameGenerate((gameAlgorithm + 1) % MAZEGEN_ALGORITHMS);
+            uart_puts("Maze generated with ");
+            uart_puts(mazegenName[gameAlgorithm]);
+            uart_puts("\n");
+            break;
+        //print the maze solver report
+        case 'h':
+            solver_report();
+            break;
+        //run the maze generator benchmark
+        case 'b':
+            mazegen_benchmark();
+            break;
+        //check that every core answers a call, and print the SMP report
+        case 'c':
+            pingCores();
+            smp_report();
+            break;
+        //run the lock and queue stress test on every core
+        case 'y':
+            sync_stress();
+            break;
+        //print the number of tasks each core has run and stolen
+        case 't':
+            task_report();
+            break;
+        //print the heap statistics, and the use of the event pool
+        case 'm':
+            heap_report();
+            pool_report("input events", &inputPool);
+            break;
+        default:
+            break;
     }
 }
-/**
- * This method returns true if player is moving into an valid space
- * @param playerRow The row index of player
- * @param playerCol The column index of player
- */
-int moveValid(int playerRow, int playerCol)
-{
-    //0 is false
-    //1 is true
-    int flag;
 
-    //hits a wall
-    if ((maze[playerRow][playerCol] == 1) || (maze[playerRow][playerCol] == 5) || (maze[playerRow][playerCol] == 6) || (maze[playerRow][playerCol] == 7) || (maze[playerRow][playerCol] == 8) || (maze[playerRow][playerCol] == 9))
-    {
-        flag = 0;
-    }
-    else
-    {
-        flag = 1;
-    }
-    return flag;
-}
-//reduces hp of wall
-int hitWall(int currentHp)
+//sends a call to every other running core, and waits for each one
+void pingCores()
 {
-    int hp;
+    unsigned int core;
 
-    if(hp == 5)
-    {
-        hp = 0;
-    }
-    else
-    {
-        hp = currentHp - 1;
-    }
-    return hp;
-}
-//checks if wall is dissolvable
-int isDestructable(int wall)
-{
-    int flag;
-    if ((wall > 4) && (wall < 10))
-    {
-        flag = 1;
-    }
-    else
-    {
-        flag = 0;
-    }
-    return flag;
-}
-//resets the maze to original
-void newGame()
-{
-    for (int i = 0; i < 12; i++)
+    for (core = 1; core < SMP_CORES; core++)
     {
-        for (int j= 0; j < 16; j++)
+        if (smp_call(core, smp_ping, 0) == 0)
         {
-            maze[i][j] = original[i][j];
+            smp_wait(core);
         }
     }
 }
@@ -0,0 +1,487 @@
+// The functions in this file generate random mazes for the game. A maze of
+// rows by cols tiles is a grid of cells (the tiles at odd rows and columns)
+// with a wall tile between each pair of neighbouring cells. A generator
+// knocks down walls until every cell can be reached from every other cell by
+// exactly one path (a "perfect" maze). Three algorithms are provided:
+//
+//   - The recursive backtracker walks from cell to cell, knocking down the
+//     wall to a random unvisited neighbour, and backs up when it is stuck.
+//     The walk is kept on an explicit stack instead of recursion, since a
+//     large maze would overflow the kernel stack. It makes long, winding
+//     corridors with few dead ends.
+//   - Kruskal's algorithm visits the walls in random order, and knocks down
+//     each wall whose two cells are not yet connected. The connected groups
+//     of cells are kept in a union-find forest. It makes many short dead
+//     ends.
+//   - Wilson's algorithm adds loop-erased random walks to the maze until it
+//     covers every cell. Every perfect maze is equally likely, but the first
+//     walks can take a long time to find the maze on a large grid.
+//
+// The random numbers come from the pseudo-random number generator in rng.c,
+// so a maze can be made again by seeding it with the same value.
+//
+// Walls between cells are destructible (with 5 hit points), and the tiles
+// around the grid are solid walls. The entrance is on the left side and the
+// exit on the right side of the maze, each on a random row.
+
+// Header files
+#include "uart.h"
+#include "systimer.h"
+#include "rng.h"
+#include "game.h"
+#include "mazegen.h"
+#include "heap.h"
+
+// Names of the algorithms (indexed by MAZEGEN_*)
+char *mazegenName[MAZEGEN_ALGORITHMS] =
+    {
+        "backtracker",
+        "kruskal",
+        "wilson"
+    };
+
+// Maze sizes used by the benchmark, in columns and rows of tiles. Sizes
+// larger than MAZE_MAX_ROWS by MAZE_MAX_COLS cannot be played, and only
+// show how the algorithms scale.
+#define MAZEGEN_BENCHMARK_SIZES     6
+
+int mazegenBenchmarkSize[MAZEGEN_BENCHMARK_SIZES][2] =
+    {
+        {16, 12},
+        {64, 48},
+        {256, 256},
+        {1024, 1024},
+        {2048, 2048},
+        {4096, 4096}
+    };
+
+// Marks a cell that Wilson's algorithm has walked through, but not yet added
+// to the maze. The low bits hold the direction the walk left the cell in.
+#define MAZEGEN_WALKED      0x80
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_clear
+//
+//  Arguments:      tiles:         The tiles of the maze (row by row)
+//                  rows, cols:    The size of the maze in tiles
+//                  cellRows:      The number of rows of cells
+//                  cellCols:      The number of columns of cells
+//
+//  Returns:        void
+//
+//  Description:    This function fills the grid of cells with destructible
+//                  walls, and the tiles around it with solid walls. If rows
+//                  or cols is even, the extra row or column is a solid wall
+//                  too.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void mazegen_clear(unsigned char *tiles, int rows, int cols,
+                          int cellRows, int cellCols)
+{
+    int row, col;
+
+    for (row = 0; row < rows; row++) {
+        for (col = 0; col < cols; col++) {
+            if ((row == 0) || (row > 2 * cellRows - 1) ||
+                (col == 0) || (col > 2 * cellCols - 1)) {
+                tiles[row * cols + col] = TILE_WALL;
+            } else {
+                tiles[row * cols + col] = TILE_WALL_HP5;
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_backtracker
+//
+//  Arguments:      tiles:         The tiles of the maze (row by row)
+//                  cols:          The number of columns of tiles
+//                  cellRows:      The number of rows of cells
+//                  cellCols:      The number of columns of cells
+//                  stack:         Scratch memory for one entry per cell
+//
+//  Returns:        void
+//
+//  Description:    This function carves the maze with a depth-first walk
+//                  from a random cell. The stack holds the tile offsets of
+//                  the cells on the way back to the first one. A cell is
+//                  unvisited while its tile is still a wall, and the wall
+//                  next to a cell is solid at the edge of the grid, so no
+//                  separate visited flags or bounds checks are needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void mazegen_backtracker(unsigned char *tiles, int cols,
+                                int cellRows, int cellCols,
+                                unsigned int *stack)
+{
+    int step[4] = {-1, 1, -cols, cols};
+    int next[4];
+    unsigned int top, cell;
+    int i, count;
+
+    top = 0;
+    cell = (2 * rng_below(cellRows) + 1) * cols + 2 * rng_below(cellCols) + 1;
+    tiles[cell] = TILE_PATH;
+    stack[top++] = cell;
+
+    while (top) {
+        cell = stack[top - 1];
+
+        // Find the unvisited neighbours of the cell
+        count = 0;
+        for (i = 0; i < 4; i++) {
+            if ((tiles[cell + step[i]] == TILE_WALL_HP5) &&
+                (tiles[cell + 2 * step[i]] != TILE_PATH)) {
+                next[count++] = step[i];
+            }
+        }
+
+        // Back up if there are none, or else move to one of them
+        if (count == 0) {
+            top--;
+            continue;
+        }
+
+        i = next[count == 1 ? 0 : rng_below(count)];
+        tiles[cell + i] = TILE_PATH;
+        tiles[cell + 2 * i] = TILE_PATH;
+        stack[top++] = cell + 2 * i;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_find
+//
+//  Arguments:      parent:     The union-find forest
+//                  cell:       A cell number
+//
+//  Returns:        The number of the cell at the root of the cell's tree.
+//
+//  Description:    This function follows the parent links to the root of a
+//                  tree. Each cell on the way is linked to its grandparent
+//                  (path halving), which keeps the trees shallow.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int mazegen_find(unsigned int *parent, unsigned int cell)
+{
+    while (parent[cell] != cell) {
+        parent[cell] = parent[parent[cell]];
+        cell = parent[cell];
+    }
+
+    return cell;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_kruskal
+//
+//  Arguments:      tiles:         The tiles of the maze (row by row)
+//                  cols:          The number of columns of tiles
+//                  cellRows:      The number of rows of cells
+//                  cellCols:      The number of columns of cells
+//                  scratch:       Scratch memory for one parent link per cell
+//                                 and one entry per wall
+//
+//  Returns:        void
+//
+//  Description:    This function lists the walls between cells, shuffles
+//                  them (Fisher-Yates), and knocks down every wall between
+//                  two cells that are in different trees of the union-find
+//                  forest, joining the trees. Each wall is stored as the
+//                  number of the cell to its left or above it, times 2, plus
+//                  1 if it is below the cell.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void mazegen_kruskal(unsigned char *tiles, int cols,
+                            int cellRows, int cellCols,
+                            unsigned int *scratch)
+{
+    unsigned int cells = cellRows * cellCols;
+    unsigned int *parent = scratch;
+    unsigned int *walls = scratch + cells;
+    unsigned int count, i, j, wall, cell, other, tile;
+    int row, col;
+
+    // Every cell starts as a tree of its own, and every wall is listed
+    count = 0;
+    for (row = 0; row < cellRows; row++) {
+        for (col = 0; col < cellCols; col++) {
+            cell = row * cellCols + col;
+            parent[cell] = cell;
+            tiles[(2 * row + 1) * cols + 2 * col + 1] = TILE_PATH;
+
+            if (col < cellCols - 1) {
+                walls[count++] = cell * 2;
+            }
+            if (row < cellRows - 1) {
+                walls[count++] = cell * 2 + 1;
+            }
+        }
+    }
+
+    // Shuffle the walls
+    for (i = count - 1; i > 0; i--) {
+        j = rng_below(i + 1);
+        wall = walls[i];
+        walls[i] = walls[j];
+        walls[j] = wall;
+    }
+
+    // Knock down the walls between cells that are not yet connected
+    for (i = 0; i < count; i++) {
+        cell = walls[i] >> 1;
+        other = (walls[i] & 0x1) ? cell + cellCols : cell + 1;
+
+        cell = mazegen_find(parent, cell);
+        other = mazegen_find(parent, other);
+        if (cell == other) {
+            continue;
+        }
+        parent[cell] = other;
+
+        cell = walls[i] >> 1;
+        row = cell / cellCols;
+        col = cell - row * cellCols;
+        tile = (2 * row + 1) * cols + 2 * col + 1;
+        tiles[(walls[i] & 0x1) ? tile + cols : tile + 1] = TILE_PATH;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_wilson
+//
+//  Arguments:      tiles:         The tiles of the maze (row by row)
+//                  cols:          The number of columns of tiles
+//                  cellRows:      The number of rows of cells
+//                  cellCols:      The number of columns of cells
+//
+//  Returns:        void
+//
+//  Description:    This function starts the maze with one random cell. Then,
+//                  from each cell not yet in the maze, it takes a random
+//                  walk until it reaches the maze, and adds the path of the
+//                  walk to the maze. The direction the walk last left each
+//                  cell in is written into the cell's tile (with the
+//                  MAZEGEN_WALKED bit set), so when the walk crosses itself
+//                  the loop is forgotten, and following the directions from
+//                  the start gives the loop-erased path. No scratch memory
+//                  is needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void mazegen_wilson(unsigned char *tiles, int cols,
+                           int cellRows, int cellCols)
+{
+    int step[4] = {-1, 1, -cols, cols};
+    unsigned int start, cell, direction;
+    int row, col;
+
+    cell = (2 * rng_below(cellRows) + 1) * cols + 2 * rng_below(cellCols) + 1;
+    tiles[cell] = TILE_PATH;
+
+    for (row = 0; row < cellRows; row++) {
+        for (col = 0; col < cellCols; col++) {
+            start = (2 * row + 1) * cols + 2 * col + 1;
+
+            // Walk until the maze is reached, remembering the way out of
+            // each cell. Solid walls are at the edge of the grid.
+            cell = start;
+            while (tiles[cell] != TILE_PATH) {
+                do {
+                    direction = rng_next() >> 30;
+                } while (tiles[cell + step[direction]] == TILE_WALL);
+
+                tiles[cell] = MAZEGEN_WALKED | direction;
+                cell += 2 * step[direction];
+            }
+
+            // Add the loop-erased path to the maze
+            cell = start;
+            while (tiles[cell] != TILE_PATH) {
+                direction = tiles[cell] & ~MAZEGEN_WALKED;
+                tiles[cell] = TILE_PATH;
+                tiles[cell + step[direction]] = TILE_PATH;
+                cell += 2 * step[direction];
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen
+//
+//  Arguments:      algorithm:     MAZEGEN_BACKTRACKER, KRUSKAL, or WILSON
+//                  tiles:         Where to write the tiles (row by row)
+//                  rows, cols:    The size of the maze in tiles (at least 3)
+//                  scratch:       Scratch memory of at least
+//                                 mazegen_scratch_size() bytes
+//
+//  Returns:        The row of the entrance, which is in column 0.
+//
+//  Description:    This function generates a random maze with the
+//                  algorithm, and opens the entrance and the exit.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int mazegen(int algorithm, unsigned char *tiles, int rows, int cols,
+            void *scratch)
+{
+    int cellRows = (rows - 1) / 2;
+    int cellCols = (cols - 1) / 2;
+    int entrance, exitRow;
+
+    mazegen_clear(tiles, rows, cols, cellRows, cellCols);
+
+    switch (algorithm) {
+        case MAZEGEN_KRUSKAL:
+            mazegen_kruskal(tiles, cols, cellRows, cellCols, scratch);
+            break;
+        case MAZEGEN_WILSON:
+            mazegen_wilson(tiles, cols, cellRows, cellCols);
+            break;
+        default:
+            mazegen_backtracker(tiles, cols, cellRows, cellCols, scratch);
+            break;
+    }
+
+    entrance = 2 * rng_below(cellRows) + 1;
+    exitRow = 2 * rng_below(cellRows) + 1;
+    tiles[entrance * cols] = TILE_PATH;
+    tiles[exitRow * cols + 2 * cellCols] = TILE_EXIT;
+
+    return entrance;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_scratch_size
+//
+//  Arguments:      algorithm:     MAZEGEN_BACKTRACKER, KRUSKAL, or WILSON
+//                  rows, cols:    The size of the maze in tiles
+//
+//  Returns:        The number of bytes of scratch memory mazegen() needs.
+//
+//  Description:    The backtracker needs a stack entry for every cell in
+//                  the worst case. Kruskal's algorithm needs a parent link
+//                  for every cell and an entry for every wall between cells.
+//                  Wilson's algorithm keeps everything in the tiles.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long mazegen_scratch_size(int algorithm, int rows, int cols)
+{
+    unsigned long cellRows = (rows - 1) / 2;
+    unsigned long cellCols = (cols - 1) / 2;
+    unsigned long cells = cellRows * cellCols;
+
+    switch (algorithm) {
+        case MAZEGEN_KRUSKAL:
+            return 4 * (cells + cellRows * (cellCols - 1) +
+                        (cellRows - 1) * cellCols);
+        case MAZEGEN_WILSON:
+            return 0;
+        default:
+            return 4 * cells;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mazegen_benchmark
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function generates a maze of each benchmark size
+//                  with each algorithm, and writes the time taken (in
+//                  microseconds) and the memory used (the tiles plus the
+//                  scratch memory, in bytes) to the console. All values are
+//                  hexadecimal. The mazes are built in memory taken from the
+//                  heap, so the game is not disturbed, but the largest sizes
+//                  take several seconds each, during which the game is not
+//                  updated. Sizes that do not fit in the heap are skipped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mazegen_benchmark()
+{
+    unsigned char *tiles;
+    unsigned long start, elapsed, memory, tileBytes, scratchBytes;
+    int algorithm, size, rows, cols;
+
+    uart_puts("\nMaze generator benchmark:\n");
+
+    for (size = 0; size < MAZEGEN_BENCHMARK_SIZES; size++) {
+        cols = mazegenBenchmarkSize[size][0];
+        rows = mazegenBenchmarkSize[size][1];
+
+        // Take the tiles and the most scratch memory any algorithm needs
+        tileBytes = ((unsigned long)rows * cols + 15) & ~15UL;
+        scratchBytes = 0;
+        for (algorithm = 0; algorithm < MAZEGEN_ALGORITHMS; algorithm++) {
+            memory = mazegen_scratch_size(algorithm, rows, cols);
+            if (memory > scratchBytes) {
+                scratchBytes = memory;
+            }
+        }
+        tiles = heap_alloc(tileBytes + scratchBytes);
+        if (tiles == 0) {
+            uart_puts("    0x");
+            uart_puthex(cols);
+            uart_puts(" x 0x");
+            uart_puthex(rows);
+            uart_puts(":  not enough memory\n");
+            continue;
+        }
+
+        for (algorithm = 0; algorithm < MAZEGEN_ALGORITHMS; algorithm++) {
+            start = get_timer_counter();
+            mazegen(algorithm, tiles, rows, cols, tiles + tileBytes);
+            elapsed = get_timer_counter() - start;
+            memory = (unsigned long)rows * cols +
+                     mazegen_scratch_size(algorithm, rows, cols);
+
+            uart_puts("    ");
+            uart_puts(mazegenName[algorithm]);
+            uart_puts(" 0x");
+            uart_puthex(cols);
+            uart_puts(" x 0x");
+            uart_puthex(rows);
+            uart_puts(":  0x");
+            uart_puthex((unsigned int)elapsed);
+            uart_puts(" us,  0x");
+            uart_puthex((unsigned int)memory);
+            uart_puts(" bytes\n");
+        }
+
+        heap_free(tiles);
+    }
+}
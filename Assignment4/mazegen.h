@@ -0,0 +1,20 @@
+#ifndef MAZEGEN_H
+#define MAZEGEN_H
+
+// Definitions and function prototypes for the maze generator in mazegen.c
+
+// Maze generation algorithms
+#define MAZEGEN_BACKTRACKER     0
+#define MAZEGEN_KRUSKAL         1
+#define MAZEGEN_WILSON          2
+#define MAZEGEN_ALGORITHMS      3
+
+extern char *mazegenName[MAZEGEN_ALGORITHMS];
+
+// Function prototypes
+int mazegen(int algorithm, unsigned char *tiles, int rows, int cols,
+            void *scratch);
+unsigned long mazegen_scratch_size(int algorithm, int rows, int cols);
+void mazegen_benchmark();
+
+#endif
@@ -0,0 +1,404 @@
+// The functions in this file drive the Performance Monitors Unit (PMU) of
+// the Cortex-A53. Besides the cycle counter, the PMU has 6 event counters,
+// each of which can be programmed (with PMEVTYPERn_EL0) to count one kind
+// of event, such as data cache refills or mispredicted branches. The
+// counters are read with PMEVCNTRn_EL0.
+//
+// On top of the counters, the perf_region functions accumulate the cycles
+// and the selected events spent in named regions of code. A region is
+// created once with perf_region_create(), and the code to be measured is
+// bracketed with perf_region_begin() and perf_region_end(). Regions may be
+// nested, but a region must not be entered again before it has ended. The
+// totals are written to the console with perf_report().
+
+// Header files
+#include "uart.h"
+#include "pmu.h"
+
+// One named region, with its accumulated totals and the counter values
+// captured by the last call to perf_region_begin()
+struct perf_region {
+    char *name;
+    unsigned long entries;
+    unsigned long cycles;
+    unsigned long events[PMU_MAX_EVENTS];
+    unsigned long startCycles;
+    unsigned long startEvents[PMU_MAX_EVENTS];
+};
+
+// PMU global variables
+unsigned int pmuEvents[PMU_MAX_EVENTS];
+int pmuEventCount;
+int pmuCounters;
+struct perf_region perfRegions[PERF_MAX_REGIONS];
+int perfRegionCount;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function enables the PMU and its 64-bit cycle
+//                  counter, and resets all of the counters. The number of
+//                  event counters implemented is read from the N field of
+//                  the Performance Monitors Control Register. No events are
+//                  counted until pmu_select_events() is called.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pmu_init()
+{
+    unsigned long r;
+
+    // Find out how many event counters are implemented (PMCR_EL0.N)
+    asm volatile("mrs %0, pmcr_el0" : "=r" (r));
+    pmuCounters = (r >> 11) & 0x1F;
+    if (pmuCounters > PMU_MAX_EVENTS) {
+        pmuCounters = PMU_MAX_EVENTS;
+    }
+
+    // Count cycles at all exception levels (the NSH bit of PMCCFILTR_EL0)
+    asm volatile("msr pmccfiltr_el0, %0" : : "r" (1UL << 27));
+
+    // Enable the cycle counter in the Count Enable Set Register
+    asm volatile("msr pmcntenset_el0, %0" : : "r" (1UL << 31));
+
+    // Enable the PMU (E), reset the event counters (P) and the cycle counter
+    // (C), and use a 64-bit cycle counter (LC)
+    asm volatile("msr pmcr_el0, %0" : : "r" ((1UL << 6) | (1UL << 2) | (1UL << 1) | 0x1));
+    asm volatile("isb");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_write_event_type
+//
+//  Arguments:      counter:    The event counter number (0 - 5)
+//                  event:      The event number to count
+//
+//  Returns:        void
+//
+//  Description:    This function writes the event number into the Event
+//                  Type Register of the given counter. The filter bits are
+//                  left at 0, so events are counted at EL0 and EL1. The
+//                  register name encodes the counter number, so a switch
+//                  statement is used to pick the right instruction.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void pmu_write_event_type(int counter, unsigned long event)
+{
+    switch (counter) {
+    case 0: asm volatile("msr pmevtyper0_el0, %0" : : "r" (event)); break;
+    case 1: asm volatile("msr pmevtyper1_el0, %0" : : "r" (event)); break;
+    case 2: asm volatile("msr pmevtyper2_el0, %0" : : "r" (event)); break;
+    case 3: asm volatile("msr pmevtyper3_el0, %0" : : "r" (event)); break;
+    case 4: asm volatile("msr pmevtyper4_el0, %0" : : "r" (event)); break;
+    case 5: asm volatile("msr pmevtyper5_el0, %0" : : "r" (event)); break;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_select_events
+//
+//  Arguments:      events:     An array of event numbers (PMU_EVENT_...)
+//                  count:      The number of events in the array
+//
+//  Returns:        The number of events that will be counted. This is less
+//                  than count if there are not enough event counters.
+//
+//  Description:    This function programs one event counter for each of the
+//                  given events, resets the counters, and enables them.
+//                  Any accumulated region totals no longer match the new
+//                  events, so they are cleared as well.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int pmu_select_events(unsigned int *events, int count)
+{
+    int i;
+    unsigned long r;
+
+    if (count > pmuCounters) {
+        count = pmuCounters;
+    }
+
+    // Disable all of the event counters while they are reprogrammed
+    asm volatile("msr pmcntenclr_el0, %0" : : "r" (0x7FFFFFFFUL));
+
+    for (i = 0; i < count; i++) {
+        pmuEvents[i] = events[i];
+        pmu_write_event_type(i, events[i]);
+    }
+    pmuEventCount = count;
+
+    // Reset the event counters (P bit), then enable the ones in use
+    asm volatile("mrs %0, pmcr_el0" : "=r" (r));
+    asm volatile("msr pmcr_el0, %0" : : "r" (r | (1UL << 1)));
+    asm volatile("msr pmcntenset_el0, %0" : : "r" ((1UL << count) - 1));
+    asm volatile("isb");
+
+    perf_region_reset();
+
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_read_cycles
+//
+//  Arguments:      none
+//
+//  Returns:        The current value of the 64-bit cycle counter.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long pmu_read_cycles()
+{
+    unsigned long cycles;
+
+    asm volatile("mrs %0, pmccntr_el0" : "=r" (cycles));
+    return cycles;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_read_events
+//
+//  Arguments:      values:     An array with room for PMU_MAX_EVENTS values
+//
+//  Returns:        void
+//
+//  Description:    This function reads the event counters selected with
+//                  pmu_select_events() into the given array, in the same
+//                  order as the events were selected. The cases fall
+//                  through, so only the counters in use are read.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pmu_read_events(unsigned long *values)
+{
+    switch (pmuEventCount) {
+    case 6: asm volatile("mrs %0, pmevcntr5_el0" : "=r" (values[5]));
+    case 5: asm volatile("mrs %0, pmevcntr4_el0" : "=r" (values[4]));
+    case 4: asm volatile("mrs %0, pmevcntr3_el0" : "=r" (values[3]));
+    case 3: asm volatile("mrs %0, pmevcntr2_el0" : "=r" (values[2]));
+    case 2: asm volatile("mrs %0, pmevcntr1_el0" : "=r" (values[1]));
+    case 1: asm volatile("mrs %0, pmevcntr0_el0" : "=r" (values[0]));
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       perf_region_create
+//
+//  Arguments:      name:      The name of the region, used in the report
+//
+//  Returns:        The region number to pass to perf_region_begin() and
+//                  perf_region_end(), or -1 if there are no free regions.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int perf_region_create(char *name)
+{
+    if (perfRegionCount >= PERF_MAX_REGIONS) {
+        return -1;
+    }
+
+    perfRegions[perfRegionCount].name = name;
+    return perfRegionCount++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       perf_region_begin
+//
+//  Arguments:      region:    A region number from perf_region_create()
+//
+//  Returns:        void
+//
+//  Description:    This function captures the event counters and the cycle
+//                  counter at the start of the region. The cycle counter is
+//                  read last, so that reading the event counters is not
+//                  charged to the region.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void perf_region_begin(int region)
+{
+    struct perf_region *r;
+
+    if (region < 0) {
+        return;
+    }
+
+    r = &perfRegions[region];
+    pmu_read_events(r->startEvents);
+    r->startCycles = pmu_read_cycles();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       perf_region_end
+//
+//  Arguments:      region:    A region number from perf_region_create()
+//
+//  Returns:        void
+//
+//  Description:    This function reads the counters at the end of the
+//                  region, and adds the differences from the values
+//                  captured by perf_region_begin() to the region totals.
+//                  The event counters are only 32 bits wide, so their
+//                  differences are taken in 32 bits, which stays right if a
+//                  counter wraps inside the region.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void perf_region_end(int region)
+{
+    int i;
+    unsigned long cycles, values[PMU_MAX_EVENTS];
+    struct perf_region *r;
+
+    cycles = pmu_read_cycles();
+    if (region < 0) {
+        return;
+    }
+    pmu_read_events(values);
+
+    r = &perfRegions[region];
+    r->entries++;
+    r->cycles += cycles - r->startCycles;
+    for (i = 0; i < pmuEventCount; i++) {
+        r->events[i] += (unsigned int)(values[i] - r->startEvents[i]);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       perf_region_reset
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function clears the totals of every region.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void perf_region_reset()
+{
+    int i, j;
+
+    for (i = 0; i < perfRegionCount; i++) {
+        perfRegions[i].entries = 0;
+        perfRegions[i].cycles = 0;
+        for (j = 0; j < PMU_MAX_EVENTS; j++) {
+            perfRegions[i].events[j] = 0;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pmu_event_name
+//
+//  Arguments:      event:     An event number
+//
+//  Returns:        A short name for the event, used in the report.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static char *pmu_event_name(unsigned int event)
+{
+    switch (event) {
+    case PMU_EVENT_L1I_CACHE_REFILL:    return "L1I_CACHE_REFILL";
+    case PMU_EVENT_L1I_TLB_REFILL:      return "L1I_TLB_REFILL";
+    case PMU_EVENT_L1D_CACHE_REFILL:    return "L1D_CACHE_REFILL";
+    case PMU_EVENT_L1D_CACHE:           return "L1D_CACHE";
+    case PMU_EVENT_L1D_TLB_REFILL:      return "L1D_TLB_REFILL";
+    case PMU_EVENT_LD_RETIRED:          return "LD_RETIRED";
+    case PMU_EVENT_ST_RETIRED:          return "ST_RETIRED";
+    case PMU_EVENT_INST_RETIRED:        return "INST_RETIRED";
+    case PMU_EVENT_EXC_TAKEN:           return "EXC_TAKEN";
+    case PMU_EVENT_BR_MIS_PRED:         return "BR_MIS_PRED";
+    case PMU_EVENT_CPU_CYCLES:          return "CPU_CYCLES";
+    case PMU_EVENT_BR_PRED:             return "BR_PRED";
+    case PMU_EVENT_MEM_ACCESS:          return "MEM_ACCESS";
+    case PMU_EVENT_L1I_CACHE:           return "L1I_CACHE";
+    case PMU_EVENT_L2D_CACHE:           return "L2D_CACHE";
+    case PMU_EVENT_L2D_CACHE_REFILL:    return "L2D_CACHE_REFILL";
+    case PMU_EVENT_BUS_ACCESS:          return "BUS_ACCESS";
+    default:                            return "EVENT";
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       perf_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the totals of every region to the
+//                  console: the number of times the region was entered, the
+//                  cycles spent in it, and the count of each selected event.
+//                  The 64-bit totals are written as two 32-bit halves.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void perf_report()
+{
+    int i, j;
+    struct perf_region *r;
+
+    uart_puts("\nPerformance counter report:\n");
+
+    for (i = 0; i < perfRegionCount; i++) {
+        r = &perfRegions[i];
+
+        uart_puts("  ");
+        uart_puts(r->name);
+        uart_puts("\n    entries:  0x");
+        uart_puthex((unsigned int)r->entries);
+        uart_puts("\n    cycles:  0x");
+        uart_puthex((unsigned int)(r->cycles >> 32));
+        uart_puthex((unsigned int)r->cycles);
+
+        for (j = 0; j < pmuEventCount; j++) {
+            uart_puts("\n    ");
+            uart_puts(pmu_event_name(pmuEvents[j]));
+            uart_puts(":  0x");
+            uart_puthex((unsigned int)(r->events[j] >> 32));
+            uart_puthex((unsigned int)r->events[j]);
+        }
+        uart_puts("\n");
+    }
+}
@@ -0,0 +1,42 @@
+// Definitions and function prototypes for the Performance Monitors Unit
+// (PMU) driver in pmu.c.
+//
+// The event numbers are the common architectural events supported by the
+// Cortex-A53. They are listed in the Cortex-A53 Technical Reference Manual,
+// section 12.9 (PMU events).
+
+#define PMU_EVENT_L1I_CACHE_REFILL      0x01
+#define PMU_EVENT_L1I_TLB_REFILL        0x02
+#define PMU_EVENT_L1D_CACHE_REFILL      0x03
+#define PMU_EVENT_L1D_CACHE             0x04
+#define PMU_EVENT_L1D_TLB_REFILL        0x05
+#define PMU_EVENT_LD_RETIRED            0x06
+#define PMU_EVENT_ST_RETIRED            0x07
+#define PMU_EVENT_INST_RETIRED          0x08
+#define PMU_EVENT_EXC_TAKEN             0x09
+#define PMU_EVENT_BR_MIS_PRED           0x10
+#define PMU_EVENT_CPU_CYCLES            0x11
+#define PMU_EVENT_BR_PRED               0x12
+#define PMU_EVENT_MEM_ACCESS            0x13
+#define PMU_EVENT_L1I_CACHE             0x14
+#define PMU_EVENT_L2D_CACHE             0x16
+#define PMU_EVENT_L2D_CACHE_REFILL      0x17
+#define PMU_EVENT_BUS_ACCESS            0x19
+
+// The Cortex-A53 has 6 event counters, plus the cycle counter
+#define PMU_MAX_EVENTS                  6
+
+// The maximum number of named code regions
+#define PERF_MAX_REGIONS                16
+
+// Function prototypes
+void pmu_init();
+int pmu_select_events(unsigned int *events, int count);
+unsigned long pmu_read_cycles();
+void pmu_read_events(unsigned long *values);
+
+int perf_region_create(char *name);
+void perf_region_begin(int region);
+void perf_region_end(int region);
+void perf_region_reset();
+void perf_report();
@@ -0,0 +1,378 @@
+// The functions in this file implement a function-level cycle profiler.
+// When the kernel is built with 'make PROFILE=1', gcc inserts a call to
+// __cyg_profile_func_enter() at the start of every function, and a call to
+// __cyg_profile_func_exit() just before every function returns. These hooks
+// read the PMU cycle counter (PMCCNTR_EL0) of the Cortex-A53, and accumulate
+// the number of calls, the inclusive cycles, and the self cycles of every
+// caller/callee pair into a fixed-size call-graph table.
+//
+// The table is dumped over the UART with profile_dump(). The addresses in the
+// dump can be mapped back to function names on the host with the script
+// tools/profsym.py, using the kernel8.elf or kernel8.dump file created by
+// the Makefile.
+
+// Header files
+#include "uart.h"
+#include "profile.h"
+#include "pmu.h"
+
+// Size of the call-graph table (must be a power of 2), and the maximum call
+// depth that is tracked on the shadow stack
+#define PROFILE_TABLE_SIZE     512
+#define PROFILE_MAX_DEPTH      64
+
+// One entry in the call-graph table. The caller is identified by the call
+// site (the return address into the calling function), and the callee by
+// the address of its first instruction.
+struct profile_edge {
+    unsigned long caller;
+    unsigned long callee;
+    unsigned long calls;
+    unsigned long inclusive;
+    unsigned long self;
+};
+
+// One frame on the shadow stack, recording when the function was entered,
+// and how many cycles were spent in the functions it called
+struct profile_frame {
+    struct profile_edge *edge;
+    unsigned long start;
+    unsigned long children;
+};
+
+// Profiler global variables
+struct profile_edge profileTable[PROFILE_TABLE_SIZE];
+struct profile_frame profileStack[PROFILE_MAX_DEPTH];
+unsigned int profileDepth;
+unsigned int profileActive;
+unsigned long profileStartCycles;
+unsigned int profileTableFull;
+unsigned int profileStackOverflow;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       read_cycle_counter
+//
+//  Arguments:      none
+//
+//  Returns:        The current value of the PMU cycle counter.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static inline NO_INSTRUMENT unsigned long read_cycle_counter()
+{
+    unsigned long cycles;
+
+    asm volatile("mrs %0, pmccntr_el0" : "=r" (cycles));
+    return cycles;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       profile_lookup
+//
+//  Arguments:      caller:     The call site in the calling function
+//                  callee:     The address of the called function
+//
+//  Returns:        A pointer to the call-graph table entry for this pair,
+//                  or 0 if the table is full.
+//
+//  Description:    This function finds the entry for the caller/callee pair
+//                  in the call-graph table using open addressing with linear
+//                  probing, and creates the entry if it does not exist yet.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static NO_INSTRUMENT struct profile_edge *profile_lookup(unsigned long caller,
+                                                         unsigned long callee)
+{
+    unsigned int i, probe;
+    struct profile_edge *edge;
+
+    // Hash the two addresses. The low 2 bits are always 0, so skip them.
+    i = (unsigned int)(((callee >> 2) * 2654435761UL) ^ (caller >> 2));
+
+    for (probe = 0; probe < PROFILE_TABLE_SIZE; probe++) {
+        edge = &profileTable[(i + probe) & (PROFILE_TABLE_SIZE - 1)];
+
+        // Return the matching entry, or claim the first empty one
+        if (edge->callee == callee && edge->caller == caller) {
+            return edge;
+        }
+        if (edge->callee == 0) {
+            edge->caller = caller;
+            edge->callee = callee;
+            return edge;
+        }
+    }
+
+    // If here, every entry is in use by another pair
+    profileTableFull++;
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       on_core_0
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if this code runs on core 0. The profile
+//                  only follows core 0, since the other cores (which run
+//                  tasks, see task.c) would corrupt the shadow stack.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static inline NO_INSTRUMENT int on_core_0()
+{
+    unsigned long mpidr;
+
+    asm volatile("mrs %0, mpidr_el1" : "=r" (mpidr));
+    return (mpidr & 0x3) == 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       __cyg_profile_func_enter
+//
+//  Arguments:      this_fn:     The address of the function being entered
+//                  call_site:   The return address into the calling function
+//
+//  Returns:        void
+//
+//  Description:    This hook is called by the instrumented code on entry to
+//                  every function. It pushes a frame with the current cycle
+//                  count onto the shadow stack. IRQs are masked while the
+//                  shadow stack is updated, so that an instrumented interrupt
+//                  handler cannot corrupt it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NO_INSTRUMENT void __cyg_profile_func_enter(void *this_fn, void *call_site)
+{
+    unsigned long daif;
+    struct profile_frame *frame;
+
+    if (!profileActive || !on_core_0()) {
+        return;
+    }
+
+    asm volatile("mrs %0, daif" : "=r" (daif));
+    asm volatile("msr daifset, 0b0010");
+
+    // Deeper calls than we can track are still counted, so that the matching
+    // exits keep the shadow stack balanced
+    if (profileDepth < PROFILE_MAX_DEPTH) {
+        frame = &profileStack[profileDepth];
+        frame->edge = profile_lookup((unsigned long)call_site,
+                                     (unsigned long)this_fn);
+        frame->children = 0;
+        frame->start = read_cycle_counter();
+    } else {
+        profileStackOverflow++;
+    }
+    profileDepth++;
+
+    asm volatile("msr daif, %0" : : "r" (daif));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       __cyg_profile_func_exit
+//
+//  Arguments:      this_fn:     The address of the function being exited
+//                  call_site:   The return address into the calling function
+//
+//  Returns:        void
+//
+//  Description:    This hook is called by the instrumented code just before
+//                  every function returns. It pops the frame off the shadow
+//                  stack, and adds the elapsed cycles to the call-graph
+//                  table entry. The elapsed cycles are also charged to the
+//                  parent frame, so that self cycles can be calculated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NO_INSTRUMENT void __cyg_profile_func_exit(void *this_fn, void *call_site)
+{
+    unsigned long daif, elapsed;
+    struct profile_frame *frame;
+
+    if (!profileActive || profileDepth == 0 || !on_core_0()) {
+        return;
+    }
+
+    elapsed = read_cycle_counter();
+
+    asm volatile("mrs %0, daif" : "=r" (daif));
+    asm volatile("msr daifset, 0b0010");
+
+    profileDepth--;
+    if (profileDepth < PROFILE_MAX_DEPTH) {
+        frame = &profileStack[profileDepth];
+        elapsed -= frame->start;
+
+        if (frame->edge) {
+            frame->edge->calls++;
+            frame->edge->inclusive += elapsed;
+            frame->edge->self += elapsed - frame->children;
+        }
+        if (profileDepth > 0) {
+            profileStack[profileDepth - 1].children += elapsed;
+        }
+    }
+
+    asm volatile("msr daif, %0" : : "r" (daif));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       profile_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function enables the PMU cycle counter (see
+//                  pmu.c) and starts recording.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NO_INSTRUMENT void profile_init()
+{
+    pmu_init();
+    profile_reset();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       profile_reset
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function clears the call-graph table and starts a
+//                  new recording. It must be called from the same call depth
+//                  as the code that calls profile_dump() (normally main).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NO_INSTRUMENT void profile_reset()
+{
+    int i;
+
+    profileActive = 0;
+
+    for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        profileTable[i].caller = 0;
+        profileTable[i].callee = 0;
+        profileTable[i].calls = 0;
+        profileTable[i].inclusive = 0;
+        profileTable[i].self = 0;
+    }
+
+    profileDepth = 0;
+    profileTableFull = 0;
+    profileStackOverflow = 0;
+    profileStartCycles = read_cycle_counter();
+
+    profileActive = 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       profile_puthex64
+//
+//  Arguments:      value:    The 64-bit value to write to the console
+//
+//  Returns:        void
+//
+//  Description:    This function writes a 64-bit value as 16 hexadecimal
+//                  digits, using two calls to uart_puthex().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static NO_INSTRUMENT void profile_puthex64(unsigned long value)
+{
+    uart_puthex((unsigned int)(value >> 32));
+    uart_puthex((unsigned int)value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       profile_dump
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes every entry in the call-graph table
+//                  to the console, one per line, in the format:
+//
+//                      caller callee calls inclusive self
+//
+//                  All values are hexadecimal. The dump is framed by the
+//                  lines "PROFILE BEGIN" and "PROFILE END", so that the host
+//                  script can find it in a captured console log. Recording
+//                  is paused while dumping, so that the UART functions do
+//                  not profile themselves.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NO_INSTRUMENT void profile_dump()
+{
+    int i;
+    unsigned int active = profileActive;
+    struct profile_edge *edge;
+
+    profileActive = 0;
+
+    uart_puts("\nPROFILE BEGIN ");
+    profile_puthex64(read_cycle_counter() - profileStartCycles);
+    uart_puts(" ");
+    uart_puthex(profileTableFull);
+    uart_puts(" ");
+    uart_puthex(profileStackOverflow);
+    uart_puts("\n");
+
+    for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        edge = &profileTable[i];
+        if (edge->calls == 0) {
+            continue;
+        }
+
+        uart_puthex((unsigned int)edge->caller);
+        uart_puts(" ");
+        uart_puthex((unsigned int)edge->callee);
+        uart_puts(" ");
+        uart_puthex((unsigned int)edge->calls);
+        uart_puts(" ");
+        profile_puthex64(edge->inclusive);
+        uart_puts(" ");
+        profile_puthex64(edge->self);
+        uart_puts("\n");
+    }
+
+    uart_puts("PROFILE END\n");
+
+    profileActive = active;
+}
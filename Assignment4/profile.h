@@ -0,0 +1,10 @@
+// Function prototypes for the function-level cycle profiler in profile.c.
+// The profiler only records data when the kernel is built with
+// 'make PROFILE=1', which compiles every C file with -finstrument-functions.
+
+// Functions marked with this attribute are never instrumented
+#define NO_INSTRUMENT   __attribute__((no_instrument_function))
+
+void profile_init();
+void profile_reset();
+void profile_dump();
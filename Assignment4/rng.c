@@ -0,0 +1,138 @@
+// The functions in this file provide random numbers. The hardware random
+// number generator of the BCM2837 is slow (each 32-bit word takes several
+// microseconds), so it is only used to seed a fast pseudo-random number
+// generator, xoshiro128** by David Blackman and Sebastiano Vigna. Each
+// pseudo-random number takes a few shifts, rotates, and XORs, and the same
+// seed always gives the same sequence, so a level can be made again from its
+// seed.
+
+// Header files
+#include "rng.h"
+
+// The xoshiro128** state. It must never be all zeros.
+unsigned int rngState[4] = {1, 2, 3, 4};
+
+// Set when the hardware generator has been started
+unsigned int rngHardwareReady;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       rng_hardware
+//
+//  Arguments:      none
+//
+//  Returns:        A 32-bit random number from the hardware generator.
+//
+//  Description:    This function starts the hardware generator the first
+//                  time it is called (its interrupt is masked, and the first
+//                  0x40000 numbers are thrown away while it warms up), and
+//                  then waits until a number is available in the FIFO. The
+//                  top 8 bits of the status register count the numbers
+//                  available.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int rng_hardware()
+{
+    if (!rngHardwareReady) {
+        *RNG_STATUS = 0x40000;
+        *RNG_INT_MASK |= 0x1;
+        *RNG_CTRL |= 0x1;
+        rngHardwareReady = 1;
+    }
+
+    while ((*RNG_STATUS >> 24) == 0)
+        ;
+
+    return *RNG_DATA;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       rng_seed
+//
+//  Arguments:      seed:     Any 64-bit value
+//
+//  Returns:        void
+//
+//  Description:    This function sets the pseudo-random number generator
+//                  state from the seed. The seed is spread over the 128 bits
+//                  of state with the SplitMix64 generator, as recommended by
+//                  the xoshiro authors, which also makes sure that the state
+//                  is not all zeros.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void rng_seed(unsigned long seed)
+{
+    unsigned long z;
+    int i;
+
+    for (i = 0; i < 4; i += 2) {
+        seed += 0x9E3779B97F4A7C15UL;
+        z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+        z = z ^ (z >> 31);
+
+        rngState[i] = (unsigned int)z;
+        rngState[i + 1] = (unsigned int)(z >> 32);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       rng_next
+//
+//  Arguments:      none
+//
+//  Returns:        A 32-bit pseudo-random number.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int rng_next()
+{
+    unsigned int *s = rngState;
+    unsigned int result, t;
+
+    result = s[1] * 5;
+    result = ((result << 7) | (result >> 25)) * 9;
+
+    t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+
+    return result;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       rng_below
+//
+//  Arguments:      n:     The number of possible results (at least 1)
+//
+//  Returns:        A pseudo-random number from 0 to n - 1.
+//
+//  Description:    This function scales a 32-bit random number into the
+//                  range with a multiply and a shift, instead of a much
+//                  slower division. The results are very slightly biased
+//                  when n is not a power of 2, which does not matter here.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int rng_below(unsigned int n)
+{
+    return (unsigned int)(((unsigned long)rng_next() * n) >> 32);
+}
@@ -0,0 +1,24 @@
+#ifndef RNG_H
+#define RNG_H
+
+// The addresses of the hardware random number generator registers.
+//
+// The random number generator is not described in the Broadcom BCM2837 ARM
+// Peripherals Manual. These addresses are taken from the Linux bcm2835-rng
+// driver.
+
+#include "gpio.h"
+
+#define RNG_CTRL        ((volatile unsigned int *)(MMIO_BASE + 0x00104000))
+#define RNG_STATUS      ((volatile unsigned int *)(MMIO_BASE + 0x00104004))
+#define RNG_DATA        ((volatile unsigned int *)(MMIO_BASE + 0x00104008))
+#define RNG_INT_MASK    ((volatile unsigned int *)(MMIO_BASE + 0x00104010))
+
+// Function prototypes for the hardware generator and the xoshiro128**
+// pseudo-random number generator in rng.c
+unsigned int rng_hardware();
+void rng_seed(unsigned long seed);
+unsigned int rng_next();
+unsigned int rng_below(unsigned int n);
+
+#endif
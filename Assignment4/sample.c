@@ -0,0 +1,283 @@
+// The functions in this file implement a statistical sampling profiler.
+// Compare channel 1 of the BCM System Timer raises an IRQ at a fixed
+// interval. On every tick, the address of the interrupted instruction
+// (ELR_EL1) is counted in a PC histogram, and a short call chain is
+// recorded by following the frame pointer (x29) chain of the interrupted
+// code. Unlike the instrumenting profiler in profile.c, small functions are
+// not slowed down at all, and the cost of a tick is a few hundred cycles,
+// so sampling can be left on in normal builds.
+//
+// The histogram and the call chains are written to the console with
+// sample_export(), and symbolized on the host with tools/samplesym.py.
+
+// Header files
+#include "uart.h"
+#include "irq.h"
+#include "exceptions.h"
+#include "systimer.h"
+#include "sample.h"
+
+// The histogram has one bucket per instruction (4 bytes), starting at the
+// _start address, and covers 64 KB of code
+#define SAMPLE_BUCKETS          16384
+
+// Number of call chains kept (the oldest are overwritten), and the
+// maximum number of addresses in each chain
+#define SAMPLE_CHAINS           512
+#define SAMPLE_CHAIN_DEPTH      8
+
+// Size of the program stack, which lies just below _start (see start.s).
+// Frame pointers outside of it are not followed.
+#define SAMPLE_STACK_SIZE       0x20000
+
+// One recorded call chain. Entry 0 is the interrupted PC, entry 1 the link
+// register, and the rest are return addresses found on the stack.
+struct sample_chain {
+    unsigned int depth;
+    unsigned int address[SAMPLE_CHAIN_DEPTH];
+};
+
+// Sampler global variables
+unsigned int sampleHistogram[SAMPLE_BUCKETS];
+struct sample_chain sampleChains[SAMPLE_CHAINS];
+unsigned int sampleNextChain;
+unsigned int sampleTotal;
+unsigned int sampleOutOfRange;
+unsigned int sampleInterval;
+unsigned int sampleRecording;
+
+// The start of the program, provided by start.s
+extern char _start[];
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sample_start
+//
+//  Arguments:      interval:     The time between samples in microseconds
+//
+//  Returns:        void
+//
+//  Description:    This function programs compare channel 1 of the System
+//                  Timer to fire after the given interval, and enables its
+//                  interrupt in the Interrupt Enable Register 1. IRQ
+//                  exceptions must also be enabled with enableIRQ(). An
+//                  interval that is not a multiple of the main loop period
+//                  (e.g. a prime number) avoids sampling the same point in
+//                  the loop every time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sample_start(unsigned int interval)
+{
+    sampleInterval = interval;
+    sampleRecording = 1;
+
+    // Clear any old match, and set the first compare value
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_1);
+    *SYSTEM_TIMER_C1 = *SYSTEM_TIMER_CLO + interval;
+
+    // Enable the System Timer match 1 interrupt (IRQ 1)
+    *IRQ_ENABLE_IRQS_1 = (0x1 << SYSTEM_TIMER_IRQ_1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sample_stop
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function disables the System Timer match 1
+//                  interrupt, which stops the sampling profiler.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sample_stop()
+{
+    *IRQ_DISABLE_IRQS_1 = (0x1 << SYSTEM_TIMER_IRQ_1);
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_1);
+    sampleRecording = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sample_reset
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function clears the histogram and the call chains.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sample_reset()
+{
+    int i;
+    unsigned int recording = sampleRecording;
+
+    sampleRecording = 0;
+
+    for (i = 0; i < SAMPLE_BUCKETS; i++) {
+        sampleHistogram[i] = 0;
+    }
+    for (i = 0; i < SAMPLE_CHAINS; i++) {
+        sampleChains[i].depth = 0;
+    }
+
+    sampleNextChain = 0;
+    sampleTotal = 0;
+    sampleOutOfRange = 0;
+
+    sampleRecording = recording;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sample_tick
+//
+//  Arguments:      frame:     The registers saved by the IRQ exception stub
+//
+//  Returns:        void
+//
+//  Description:    This function is called by the IRQ handler when compare
+//                  channel 1 of the System Timer matches. It acknowledges
+//                  the match, sets the next compare value, and records the
+//                  interrupted PC and call chain. If the handler was late
+//                  by more than one interval, the next compare value is
+//                  taken from the current time, so that no match is missed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sample_tick(unsigned long *frame)
+{
+    unsigned long pc, fp, next, stackTop;
+    unsigned int compare, now, bucket, depth;
+    struct sample_chain *chain;
+
+    // Acknowledge the match, and schedule the next one
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_1);
+    compare = *SYSTEM_TIMER_C1 + sampleInterval;
+    now = *SYSTEM_TIMER_CLO;
+    if ((int)(compare - now) <= 0) {
+        compare = now + sampleInterval;
+    }
+    *SYSTEM_TIMER_C1 = compare;
+
+    if (!sampleRecording) {
+        return;
+    }
+
+    // Count the interrupted PC in the histogram
+    asm volatile("mrs %0, elr_el1" : "=r" (pc));
+    sampleTotal++;
+
+    bucket = (pc - (unsigned long)_start) >> 2;
+    if (pc >= (unsigned long)_start && bucket < SAMPLE_BUCKETS) {
+        sampleHistogram[bucket]++;
+    } else {
+        sampleOutOfRange++;
+    }
+
+    // Record the call chain: the PC, the link register, and the return
+    // addresses in the frame records linked by x29. We stop at the first
+    // frame pointer that is not inside the program stack, or that does not
+    // move towards the top of the stack.
+    chain = &sampleChains[sampleNextChain];
+    sampleNextChain = (sampleNextChain + 1) & (SAMPLE_CHAINS - 1);
+
+    chain->address[0] = (unsigned int)pc;
+    chain->address[1] = (unsigned int)frame[FRAME_X30];
+    depth = 2;
+
+    stackTop = (unsigned long)_start;
+    fp = frame[FRAME_X29];
+    while (depth < SAMPLE_CHAIN_DEPTH && (fp & 0x7) == 0 &&
+           fp >= stackTop - SAMPLE_STACK_SIZE && fp <= stackTop - 16) {
+        chain->address[depth++] = (unsigned int)((unsigned long *)fp)[1];
+
+        next = ((unsigned long *)fp)[0];
+        if (next <= fp) {
+            break;
+        }
+        fp = next;
+    }
+
+    chain->depth = depth;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sample_export
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the histogram and the call chains
+//                  to the console in the following format (all values are
+//                  hexadecimal):
+//
+//                      SAMPLES BEGIN interval total outOfRange
+//                      H address count          (one per non-empty bucket)
+//                      S address address ...    (one per call chain)
+//                      SAMPLES END
+//
+//                  Recording is paused while the data is written.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sample_export()
+{
+    unsigned int i, j, recording = sampleRecording;
+    struct sample_chain *chain;
+
+    sampleRecording = 0;
+
+    uart_puts("\nSAMPLES BEGIN ");
+    uart_puthex(sampleInterval);
+    uart_puts(" ");
+    uart_puthex(sampleTotal);
+    uart_puts(" ");
+    uart_puthex(sampleOutOfRange);
+    uart_puts("\n");
+
+    for (i = 0; i < SAMPLE_BUCKETS; i++) {
+        if (sampleHistogram[i]) {
+            uart_puts("H ");
+            uart_puthex((unsigned int)(unsigned long)_start + (i << 2));
+            uart_puts(" ");
+            uart_puthex(sampleHistogram[i]);
+            uart_puts("\n");
+        }
+    }
+
+    for (i = 0; i < SAMPLE_CHAINS; i++) {
+        chain = &sampleChains[i];
+        if (chain->depth == 0) {
+            continue;
+        }
+
+        uart_puts("S");
+        for (j = 0; j < chain->depth; j++) {
+            uart_puts(" ");
+            uart_puthex(chain->address[j]);
+        }
+        uart_puts("\n");
+    }
+
+    uart_puts("SAMPLES END\n");
+
+    sampleRecording = recording;
+}
@@ -0,0 +1,11 @@
+// Function prototypes for the statistical sampling profiler in sample.c
+
+// Default time between samples in microseconds. A prime number keeps the
+// samples from locking onto a periodic point in the main loop.
+#define SAMPLE_DEFAULT_INTERVAL     997
+
+void sample_start(unsigned int interval);
+void sample_stop();
+void sample_reset();
+void sample_tick(unsigned long *frame);
+void sample_export();
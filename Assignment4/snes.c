@@ -0,0 +1,649 @@
+// The functions in this file read the buttons of the SNES controller. There
+// are two backends, selected when the kernel is built:
+//
+// - By default, the controller is connected to GPIO pins 9 (LATCH),
+//   11 (CLOCK), and 10 (DATA), and the 16 bits are read by driving the
+//   CLOCK line in software. This takes about 200 microseconds of CPU time.
+//
+// - When built with 'make SNES=spi', the 16 bits are shifted in by the SPI0
+//   hardware. The DATA line must then be connected to GPIO pin 9 (SPI0
+//   MISO), CLOCK stays on GPIO pin 11 (SPI0 SCLK), and LATCH moves to GPIO
+//   pin 10, which is driven as an ordinary output. The CPU only pulses the
+//   LATCH line and starts the transfer; the SPI clock runs at about 83 kHz
+//   (the same 12 microsecond cycle as the software backend), and the result
+//   is collected from the receive FIFO when the transfer is done.
+//
+// Both backends return the buttons in the same format (see get_SNES()).
+//
+// The software backend can read several controllers at once. They all
+// share the LATCH and CLOCK lines, and controller n has its DATA line on
+// the pin snesDataPins[n]. The DATA lines are sampled together with one
+// read of GPLEV0 on each clock edge, so extra controllers take no extra
+// bus time. The DATA lines of the extra controllers use the internal
+// pull-up resistors, so a missing controller reads as no buttons pressed.
+//
+// The controller can also be read in the background with snes_poll_start().
+// Each read is then a state machine driven by compare channel 3 of the
+// System Timer: every interrupt makes one step (one edge on the LATCH or
+// CLOCK line, or one SPI transfer), and schedules the next step 6 or 12
+// microseconds later, so the CPU is never kept waiting. Completed reads are
+// published in a double buffer, and the main loop gets the latest one with
+// snes_latest(), which takes constant time.
+
+// Header files
+#include "gpio.h"
+#include "systimer.h"
+#include "irq.h"
+#include "snes.h"
+
+#ifdef SNES_SPI
+#include "spi.h"
+
+#if SNES_CONTROLLERS != 1
+#error "The SPI backend can only read one SNES controller"
+#endif
+
+// LATCH is on GPIO pin 10, DATA on pin 9 (MISO), and CLOCK on pin 11 (SCLK)
+#define SNES_LATCH      (0x1 << 10)
+
+// The SPI clock is the 250 MHz core clock divided by 3000 (83.3 kHz), and
+// idles high like the CLOCK line of the software backend. Mode 2 (CPOL = 1,
+// CPHA = 0) samples DATA on each falling edge, and the controller shifts
+// out the next bit on each rising edge.
+#define SNES_SPI_DIVIDER    3000
+#define SNES_SPI_MODE       SPI_MODE2
+
+// Pin configuration table for the SPI backend
+struct gpio_pin_config snesPins[] =
+    {
+        {10, GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {11, GPIO_ALT0,   GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {9,  GPIO_ALT0,   GPIO_PULL_NONE, GPIO_EDGE_NONE}
+    };
+#else
+
+#if SNES_CONTROLLERS > SNES_MAX_CONTROLLERS
+#error "Too many SNES controllers"
+#endif
+
+// LATCH is on GPIO pin 9, CLOCK on pin 11, and DATA of the first
+// controller on pin 10
+#define SNES_LATCH      (0x1 << 9)
+#define SNES_CLOCK      (0x1 << 11)
+
+// Pin configuration table for the software backend. LATCH and CLOCK are
+// outputs, and DATA is an input. None of the pins use the internal pull-up
+// or pull-down resistors. The DATA pins of the other controllers are added
+// by snes_init().
+struct gpio_pin_config snesPins[] =
+    {
+        {9,  GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {11, GPIO_OUTPUT, GPIO_PULL_NONE, GPIO_EDGE_NONE},
+        {10, GPIO_INPUT,  GPIO_PULL_NONE, GPIO_EDGE_NONE}
+    };
+
+// The DATA pin of each controller
+unsigned int snesDataPins[SNES_MAX_CONTROLLERS] = {10, 5, 6, 13};
+
+// The result of the last read
+unsigned short snesData[SNES_CONTROLLERS];
+#endif
+
+// States of the interrupt-driven poller
+#define SNES_STATE_IDLE         0
+#define SNES_STATE_LATCH        1
+#define SNES_STATE_CLOCK_LOW    2
+#define SNES_STATE_CLOCK_HIGH   3
+#define SNES_STATE_TRANSFER     4
+
+// Time taken by each step of a read, in microseconds. The software backend
+// runs one clock edge per step. The SPI backend waits for the whole 16-bit
+// transfer (16 cycles of 12 microseconds) in one step.
+#define SNES_LATCH_TIME         12
+#define SNES_HALF_CYCLE         6
+#define SNES_TRANSFER_TIME      200
+
+// Poller global variables. The interrupt handler fills in the buffer that
+// is not being read, and then makes it the front buffer. The publish count
+// is odd while a read is being published, and even once it is done.
+struct snes_sample snesBuffer[2];
+volatile unsigned int snesFront;
+volatile unsigned int snesPublished;
+unsigned int snesState;
+unsigned int snesBit;
+unsigned int snesPollInterval;
+unsigned int snesPollStart;
+unsigned long snesTimestamp;
+unsigned short snesBits[SNES_CONTROLLERS];
+
+#ifndef SNES_SPI
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_shift
+//
+//  Arguments:      bit:     The number of the bit being read (0 - 15)
+//                  bits:    The bits read so far, one entry per controller
+//
+//  Returns:        void
+//
+//  Description:    This function reads the DATA lines of all controllers
+//                  with a single read of GPLEV0, and stores bit number bit
+//                  of each. Note we convert a 0 (which indicates a button
+//                  press) to a 1 in the returned 16-bit integer. Unpressed
+//                  buttons will be encoded as a 0.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static inline void snes_shift(unsigned int bit, unsigned short *bits)
+{
+    unsigned int levels = gpio_read_all();
+    int pad;
+
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        if ((levels & (0x1 << snesDataPins[pad])) == 0) {
+            bits[pad] |= (0x1 << bit);
+        }
+    }
+}
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sets up the pins used by the controllers,
+//                  and sets the LATCH line low and the CLOCK line high.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_init()
+{
+#ifdef SNES_SPI
+    gpio_configure(snesPins, sizeof(snesPins) / sizeof(snesPins[0]));
+#else
+    struct gpio_pin_config pins[3 + SNES_MAX_CONTROLLERS];
+    int i, count = 3;
+
+    for (i = 0; i < 3; i++) {
+        pins[i] = snesPins[i];
+    }
+    for (i = 1; i < SNES_CONTROLLERS; i++) {
+        pins[count].pin = snesDataPins[i];
+        pins[count].function = GPIO_INPUT;
+        pins[count].pull = GPIO_PULL_UP;
+        pins[count].edge = GPIO_EDGE_NONE;
+        count++;
+    }
+    gpio_configure(pins, count);
+#endif
+
+#ifdef SNES_SPI
+    // The SPI clock idles high (CPOL = 1)
+    spi_init(SNES_SPI_DIVIDER, SNES_SPI_MODE);
+    gpio_write_mask(0, SNES_LATCH);
+#else
+    gpio_write_mask(SNES_CLOCK, SNES_LATCH);
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_start
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function starts reading the controller. The LATCH
+//                  line is set high for 12 microseconds, which causes the
+//                  controller to latch the values of the button presses into
+//                  its internal register, and puts the first bit on the DATA
+//                  line. With the SPI backend, a 2-byte transfer is then
+//                  started, and this function returns while the hardware
+//                  clocks in the bits. With the software backend, all 16
+//                  bits of every controller are read before returning.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_start()
+{
+#ifdef SNES_SPI
+    gpio_write_mask(SNES_LATCH, 0);
+    microsecond_delay(12);
+    gpio_write_mask(0, SNES_LATCH);
+
+    spi_start(2);
+#else
+    int i, pad;
+
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        snesData[pad] = 0;
+    }
+
+    gpio_write_mask(SNES_LATCH, 0);
+    microsecond_delay(12);
+    gpio_write_mask(0, SNES_LATCH);
+
+    // Output 16 clock pulses, and read 16 bits of serial data from every
+    // controller
+    for (i = 0; i < 16; i++) {
+        // Delay 6 microseconds (half a cycle), then clear the CLOCK line
+        // (creates a falling edge), and read the DATA lines
+        microsecond_delay(6);
+        gpio_write_mask(0, SNES_CLOCK);
+        snes_shift(i, snesData);
+
+        // Delay 6 microseconds (half a cycle), then set the CLOCK to 1
+        // (creates a rising edge). This causes the controllers to output
+        // the next bit, which we read half a cycle later.
+        microsecond_delay(6);
+        gpio_write_mask(SNES_CLOCK, 0);
+    }
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_ready
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the read started by snes_start() has
+//                  finished, so that snes_collect() will not wait.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int snes_ready()
+{
+#ifdef SNES_SPI
+    return spi_done();
+#else
+    return 1;
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_collect
+//
+//  Arguments:      none
+//
+//  Returns:        The buttons read by the last call to snes_start(), in the
+//                  format described for get_SNES().
+//
+//  Description:    With the SPI backend, this function waits for the
+//                  transfer to finish, and then converts the two received
+//                  bytes. SPI shifts the bits in most significant bit first,
+//                  so the first bit (button B) ends up in bit 15 of the two
+//                  bytes; the bits are reversed with the RBIT instruction,
+//                  and then inverted, since the DATA line is low when a
+//                  button is pressed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short snes_collect()
+{
+#ifdef SNES_SPI
+    unsigned char rx[2];
+    unsigned int bits;
+
+    spi_finish(rx, 2);
+
+    bits = (rx[0] << 8) | rx[1];
+    asm volatile("rbit %w0, %w1" : "=r" (bits) : "r" (bits));
+
+    return (unsigned short)~(bits >> 16);
+#else
+    return snesData[0];
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_collect_all
+//
+//  Arguments:      buttons:    An array with SNES_CONTROLLERS entries, to
+//                              copy the buttons of every controller into
+//
+//  Returns:        void
+//
+//  Description:    This function collects the read started by the last call
+//                  to snes_start() for every controller.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_collect_all(unsigned short *buttons)
+{
+#ifdef SNES_SPI
+    buttons[0] = snes_collect();
+#else
+    int pad;
+
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        buttons[pad] = snesData[pad];
+    }
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       get_SNES
+//
+//  Arguments:      none
+//
+//  Returns:        A short integer with the button presses encoded with 16
+//                  bits. 1 means pressed, and 0 means unpressed. Bit 0 is
+//                  button B, Bit 1 is button Y, etc. up to Bit 11, which is
+//                  button R. Bits 12-15 are always 0.
+//
+//  Description:    This function samples the button presses on the SNES
+//                  controller, and waits for the result.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short get_SNES()
+{
+    snes_start();
+    return snes_collect();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_poll_start
+//
+//  Arguments:      interval:     The time between the start of two reads,
+//                                in microseconds
+//
+//  Returns:        void
+//
+//  Description:    This function starts reading the controller in the
+//                  background. It programs compare channel 3 of the System
+//                  Timer to start the first read, and enables its interrupt
+//                  in the Interrupt Enable Register 1. IRQ exceptions must
+//                  also be enabled with enableIRQ(). The interval should be
+//                  longer than one read (about 210 microseconds).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_poll_start(unsigned int interval)
+{
+    snesPollInterval = interval;
+    snesState = SNES_STATE_IDLE;
+
+    // Clear any old match, and set the first compare value
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_3);
+    *SYSTEM_TIMER_C3 = *SYSTEM_TIMER_CLO + SNES_HALF_CYCLE;
+
+    // Enable the System Timer match 3 interrupt (IRQ 3)
+    *IRQ_ENABLE_IRQS_1 = (0x1 << SYSTEM_TIMER_IRQ_3);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_poll_stop
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function disables the System Timer match 3
+//                  interrupt, which stops the background reads. A read in
+//                  progress is abandoned, and the lines are returned to
+//                  their idle levels.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_poll_stop()
+{
+    *IRQ_DISABLE_IRQS_1 = (0x1 << SYSTEM_TIMER_IRQ_3);
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_3);
+
+#ifdef SNES_SPI
+    if (snesState == SNES_STATE_TRANSFER) {
+        spi_finish(0, 0);
+    }
+    gpio_write_mask(0, SNES_LATCH);
+#else
+    gpio_write_mask(SNES_CLOCK, SNES_LATCH);
+#endif
+    snesState = SNES_STATE_IDLE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_publish
+//
+//  Arguments:      buttons:    The buttons read from every controller, in
+//                              the get_SNES() format
+//
+//  Returns:        void
+//
+//  Description:    This function stores a completed read in the back
+//                  buffer, and then makes it the front buffer. The publish
+//                  count is made odd before the buffer is written, and even
+//                  again after the front buffer is changed, so a reader can
+//                  tell whether a publish happened while it was copying,
+//                  even if the front buffer is the same again (see
+//                  snes_latest_sample()). The barriers keep the writes in
+//                  that order.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void snes_publish(unsigned short *buttons)
+{
+    unsigned int back = snesFront ^ 1;
+    int pad;
+
+    snesPublished = snesPublished + 1;
+    asm volatile("dmb ish" : : : "memory");
+
+    for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+        snesBuffer[back].buttons[pad] = buttons[pad];
+    }
+    snesBuffer[back].timestamp = snesTimestamp;
+    snesBuffer[back].sequence = snesBuffer[back ^ 1].sequence + 1;
+
+    asm volatile("dmb ish" : : : "memory");
+    snesFront = back;
+
+    asm volatile("dmb ish" : : : "memory");
+    snesPublished = snesPublished + 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_tick
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function is called by the IRQ handler when compare
+//                  channel 3 of the System Timer matches. It acknowledges
+//                  the match, makes one step of the read, and sets the
+//                  compare value for the next step:
+//
+//                  IDLE:        set LATCH high, wait 12 microseconds
+//                  LATCH:       set LATCH low (the first bit is now on the
+//                               DATA line), wait half a cycle
+//                  CLOCK_LOW:   set CLOCK low, read a bit from every
+//                               controller, wait half a cycle
+//                  CLOCK_HIGH:  set CLOCK high, which puts the next bit on
+//                               the DATA line, and wait half a cycle; after
+//                               the 16th bit, publish the read and wait
+//                               until the next read is due
+//
+//                  With the SPI backend, the LATCH step starts a transfer
+//                  instead of clocking the bits, and the TRANSFER step
+//                  collects the result.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_tick()
+{
+    unsigned int compare, now, delay;
+#ifndef SNES_SPI
+    int pad;
+#endif
+
+    *SYSTEM_TIMER_CS = (0x1 << SYSTEM_TIMER_IRQ_3);
+    compare = *SYSTEM_TIMER_C3;
+    delay = SNES_HALF_CYCLE;
+
+    switch (snesState) {
+    case SNES_STATE_IDLE:
+        snesTimestamp = get_timer_counter();
+        snesPollStart = (unsigned int)snesTimestamp;
+        gpio_write_mask(SNES_LATCH, 0);
+        snesState = SNES_STATE_LATCH;
+        delay = SNES_LATCH_TIME;
+        break;
+
+    case SNES_STATE_LATCH:
+        gpio_write_mask(0, SNES_LATCH);
+#ifdef SNES_SPI
+        spi_start(2);
+        snesState = SNES_STATE_TRANSFER;
+        delay = SNES_TRANSFER_TIME;
+#else
+        snesBit = 0;
+        for (pad = 0; pad < SNES_CONTROLLERS; pad++) {
+            snesBits[pad] = 0;
+        }
+        snesState = SNES_STATE_CLOCK_LOW;
+#endif
+        break;
+
+#ifdef SNES_SPI
+    case SNES_STATE_TRANSFER:
+        snesBits[0] = snes_collect();
+        snes_publish(snesBits);
+        snesState = SNES_STATE_IDLE;
+        break;
+#else
+    case SNES_STATE_CLOCK_LOW:
+        gpio_write_mask(0, SNES_CLOCK);
+        snes_shift(snesBit, snesBits);
+        snesState = SNES_STATE_CLOCK_HIGH;
+        break;
+
+    case SNES_STATE_CLOCK_HIGH:
+        gpio_write_mask(SNES_CLOCK, 0);
+        snesBit++;
+        if (snesBit < 16) {
+            snesState = SNES_STATE_CLOCK_LOW;
+        } else {
+            snes_publish(snesBits);
+            snesState = SNES_STATE_IDLE;
+        }
+        break;
+#endif
+    }
+
+    // Between reads, wait until the next read is due
+    if (snesState == SNES_STATE_IDLE) {
+        compare = snesPollStart;
+        delay = snesPollInterval;
+    }
+
+    // If the handler was late, take the next compare value from the
+    // current time, so that no match is missed
+    compare += delay;
+    now = *SYSTEM_TIMER_CLO;
+    if ((int)(compare - now) <= 0) {
+        compare = now + delay;
+    }
+    *SYSTEM_TIMER_C3 = compare;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_latest
+//
+//  Arguments:      none
+//
+//  Returns:        The buttons of controller 0 in the latest completed
+//                  background read, in the get_SNES() format (0 before the
+//                  first read).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short snes_latest()
+{
+    return snesBuffer[snesFront].buttons[0];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_latest_pad
+//
+//  Arguments:      pad:     The controller number (0 - SNES_CONTROLLERS - 1)
+//
+//  Returns:        The buttons of the controller in the latest completed
+//                  background read, in the get_SNES() format.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short snes_latest_pad(int pad)
+{
+    return snesBuffer[snesFront].buttons[pad];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snes_latest_sample
+//
+//  Arguments:      sample:     Where to copy the latest completed read
+//
+//  Returns:        void
+//
+//  Description:    This function copies the latest completed background
+//                  read, with its timestamp and sequence number. If a read
+//                  was being published when the copy started, or the
+//                  publish count changed while copying, the copy is
+//                  repeated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void snes_latest_sample(struct snes_sample *sample)
+{
+    unsigned int published;
+
+    do {
+        published = snesPublished;
+        asm volatile("dmb ish" : : : "memory");
+        *sample = snesBuffer[snesFront];
+        asm volatile("dmb ish" : : : "memory");
+    } while ((published & 1) || (published != snesPublished));
+}
@@ -0,0 +1,69 @@
+#ifndef SNES_H
+#define SNES_H
+
+// Bits of the buttons in the 16-bit value returned by get_SNES(). A bit is
+// 1 while the button is pressed.
+#define SNES_B          0x0001
+#define SNES_Y          0x0002
+#define SNES_SELECT     0x0004
+#define SNES_START      0x0008
+#define SNES_UP         0x0010
+#define SNES_DOWN       0x0020
+#define SNES_LEFT       0x0040
+#define SNES_RIGHT      0x0080
+#define SNES_A          0x0100
+#define SNES_X          0x0200
+#define SNES_L          0x0400
+#define SNES_R          0x0800
+#define SNES_DPAD       (SNES_UP | SNES_DOWN | SNES_LEFT | SNES_RIGHT)
+
+// Number of controllers read at once. The controllers share the LATCH and
+// CLOCK lines, and each has its own DATA line (see snes.c). The SPI backend
+// can only read one controller. Up to SNES_MAX_CONTROLLERS are supported,
+// and the number can be set with 'make SNES_PADS=n'.
+#define SNES_MAX_CONTROLLERS    4
+#ifndef SNES_CONTROLLERS
+#ifdef SNES_SPI
+#define SNES_CONTROLLERS        1
+#else
+#define SNES_CONTROLLERS        2
+#endif
+#endif
+
+// Function prototypes for the SNES controller reader in snes.c.
+//
+// A read is started with snes_start(), and its result is collected later
+// with snes_collect(), so that the CPU can do other work while the bits are
+// shifted in. get_SNES() does both, and waits for the result. The functions
+// that return a single value give the buttons of controller 0.
+void snes_init();
+void snes_start();
+int snes_ready();
+unsigned short snes_collect();
+void snes_collect_all(unsigned short *buttons);
+unsigned short get_SNES();
+
+// Default time between the start of two reads by the interrupt-driven
+// poller, in microseconds (250 reads per second)
+#define SNES_DEFAULT_POLL_INTERVAL  4000
+
+// A completed read made by the interrupt-driven poller, with the buttons of
+// every controller. The timestamp is the System Timer count when the
+// buttons were latched, and the sequence number counts the completed reads.
+struct snes_sample {
+    unsigned short buttons[SNES_CONTROLLERS];
+    unsigned int sequence;
+    unsigned long timestamp;
+};
+
+// Function prototypes for the interrupt-driven poller. It uses compare
+// channel 3 of the System Timer, and must not be mixed with the functions
+// above while it is running.
+void snes_poll_start(unsigned int interval);
+void snes_poll_stop();
+void snes_tick();
+unsigned short snes_latest();
+unsigned short snes_latest_pad(int pad);
+void snes_latest_sample(struct snes_sample *sample);
+
+#endif
@@ -0,0 +1,884 @@
+// The functions in this file find the way from any tile of the maze to the
+// exit. The solver keeps a distance field: the number of steps from every
+// tile to the exit. The way out of a tile is then found by stepping to the
+// neighbour that is one step closer, so the hint follows the player without
+// solving the maze again after every move.
+//
+// The distance field is built with a breadth-first search from the exit
+// that works on bitmaps of the maze, one bit per tile and 64 tiles per word.
+// Every level of the search spreads the frontier by one tile in all four
+// directions with a few shifts and ORs per word, and masks it with the
+// passable tiles that have not been reached yet. Only the rows next to the
+// frontier are looked at. The tiles of each new frontier get their distance
+// with count trailing zeros, so the whole search costs about one word
+// operation per 64 tiles per level, plus one store per reachable tile.
+//
+// Building the bitmaps and searching a maze of 10^6 tiles takes longer than
+// a frame, so the work is split into small steps, and solver_update() only
+// does as many of them as fit in the time it is given. When a wall is
+// destroyed, the distance field is repaired instead of built again: the
+// distances can only get shorter, and the new distances are spread from the
+// opened tile with a queue, which only visits the tiles whose distance
+// changed.
+//
+// Until the distance field is ready, solver_path() falls back on an A*
+// search from the tile to the exit, with a binary heap of open tiles ordered
+// by the steps taken plus the Manhattan distance to the exit. It gives up
+// after SOLVER_ASTAR_LIMIT tiles, so it also fits in a frame.
+
+// Header files
+#include "uart.h"
+#include "systimer.h"
+#include "game.h"
+#include "heap.h"
+#include "solver.h"
+
+// Size of the bitmaps and the distance field
+#define SOLVER_WORDS        (MAZE_MAX_COLS / 64)
+#define SOLVER_TILES        (MAZE_MAX_ROWS * MAZE_MAX_COLS)
+
+// The number of tiles the repair takes from its queue between checks of the
+// time budget
+#define SOLVER_REPAIR_BATCH 64
+
+// Size of the A* heap. Each tile looked at adds at most 4 entries.
+#define SOLVER_HEAP_SIZE    (4 * SOLVER_ASTAR_LIMIT + 4)
+
+// Solver states
+#define SOLVER_IDLE         0       // no maze to solve
+#define SOLVER_BUILD        1       // building the bitmaps, row by row
+#define SOLVER_SEARCH       2       // searching from the exit, level by level
+#define SOLVER_REPAIR       3       // spreading the distances of opened walls
+#define SOLVER_DONE         4       // the distance field is complete
+
+// Row and column steps to the four neighbours of a tile
+static const int solverRowStep[4] = {-1, 1, 0, 0};
+static const int solverColStep[4] = {0, 0, -1, 1};
+
+// Solver state global variables
+int solverState = SOLVER_IDLE;
+int solverRows, solverCols, solverWords;
+int solverBuildRow;
+int solverExit;
+int solverRestart;
+
+// Bitmaps of the passable tiles, of the tiles reached by the search, and of
+// the current and next frontiers
+unsigned long solverPass[MAZE_MAX_ROWS][SOLVER_WORDS];
+unsigned long solverSeen[MAZE_MAX_ROWS][SOLVER_WORDS];
+unsigned long solverFrontier[2][MAZE_MAX_ROWS][SOLVER_WORDS];
+
+// The rows holding the current and next frontiers, the rows next to them,
+// and the level each row was last looked at in
+unsigned int solverActive[2][MAZE_MAX_ROWS];
+unsigned int solverActiveCount;
+unsigned int solverCandidate[MAZE_MAX_ROWS];
+unsigned int solverRowStamp[MAZE_MAX_ROWS];
+int solverCurrent;
+unsigned int solverLevel;
+
+// The distance field, indexed like game.maze
+unsigned int solverDistance[SOLVER_TILES];
+
+// Queue of the tiles whose distance changed, for the repair
+unsigned int solverQueue[SOLVER_TILES];
+unsigned int solverQueueHead;
+unsigned int solverQueueTail;
+
+// A* global variables. A tile's cost is only valid if its stamp matches the
+// current search, so nothing has to be cleared between searches. The heap
+// is taken from the frame arena by each search, and given back when the
+// main loop resets the arena.
+unsigned short astarStamp[SOLVER_TILES];
+unsigned short astarEpoch;
+unsigned int astarCost[SOLVER_TILES];
+unsigned long *astarHeap;
+unsigned int astarHeapSize;
+
+// Statistics global variables
+unsigned int solverFrames;
+unsigned long solverTime;
+unsigned int solverRepairs;
+unsigned int solverAstarRuns;
+unsigned int solverAstarFailures;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_start
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function starts solving the maze in the game state
+//                  from the beginning. It is called whenever a new maze is
+//                  loaded. The work is done by solver_update().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void solver_start()
+{
+    solverRows = game.rows;
+    solverCols = game.cols;
+    solverWords = (game.cols + 63) / 64;
+    solverBuildRow = 0;
+    solverExit = -1;
+    solverRestart = 0;
+    solverQueueHead = 0;
+    solverQueueTail = 0;
+
+    solverFrames = 0;
+    solverTime = 0;
+    solverRepairs = 0;
+
+    solverState = SOLVER_BUILD;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_passable
+//
+//  Arguments:      row, col:     A tile inside the maze
+//
+//  Returns:        TRUE (non-zero) if the tile is passable, FALSE (zero) if
+//                  not.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int solver_passable(int row, int col)
+{
+    return (solverPass[row][col >> 6] >> (col & 63)) & 0x1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_neighbour
+//
+//  Arguments:      row, col:     A tile inside the maze
+//                  i:            The direction (0 to 3)
+//
+//  Returns:        The index of the neighbour of the tile in the direction,
+//                  or -1 if it is outside the maze or not passable.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int solver_neighbour(int row, int col, int i)
+{
+    row += solverRowStep[i];
+    col += solverColStep[i];
+
+    if ((row < 0) || (row >= solverRows) || (col < 0) ||
+        (col >= solverCols) || !solver_passable(row, col)) {
+        return -1;
+    }
+
+    return row * solverCols + col;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_push
+//
+//  Arguments:      tile:     The index of a tile whose distance changed
+//
+//  Returns:        void
+//
+//  Description:    This function adds a tile to the repair queue. If the
+//                  queue is full, the distance field is built again instead.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void solver_push(unsigned int tile)
+{
+    if (solverQueueHead - solverQueueTail >= SOLVER_TILES) {
+        solverRestart = 1;
+        return;
+    }
+
+    solverQueue[solverQueueHead & (SOLVER_TILES - 1)] = tile;
+    solverQueueHead++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_build_row
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sets the bits of the passable tiles of the
+//                  next row in the bitmap, clears the row of the other
+//                  bitmaps and of the distance field, and looks for the exit.
+//                  When the last row is done, the search is started from the
+//                  exit. If there is no exit, there is nothing to search.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void solver_build_row()
+{
+    int row = solverBuildRow++;
+    unsigned int base = row * solverCols;
+    unsigned char tile;
+    int col, w;
+
+    for (w = 0; w < solverWords; w++) {
+        solverPass[row][w] = 0;
+        solverSeen[row][w] = 0;
+        solverFrontier[0][row][w] = 0;
+        solverFrontier[1][row][w] = 0;
+    }
+    solverRowStamp[row] = 0;
+
+    for (col = 0; col < solverCols; col++) {
+        tile = game.maze[base + col];
+        solverDistance[base + col] = SOLVER_UNREACHED;
+
+        if (tileInfo[tile].passable) {
+            solverPass[row][col >> 6] |= 0x1UL << (col & 63);
+        }
+        if ((tile == TILE_EXIT) || (tile == TILE_WON)) {
+            solverExit = base + col;
+        }
+    }
+
+    if (solverBuildRow < solverRows) {
+        return;
+    }
+
+    if (solverExit < 0) {
+        solverState = SOLVER_DONE;
+        return;
+    }
+
+    row = solverExit / solverCols;
+    col = solverExit - row * solverCols;
+    solverDistance[solverExit] = 0;
+    solverSeen[row][col >> 6] |= 0x1UL << (col & 63);
+    solverFrontier[0][row][col >> 6] = 0x1UL << (col & 63);
+    solverActive[0][0] = row;
+    solverActiveCount = 1;
+    solverCurrent = 0;
+    solverLevel = 0;
+
+    solverState = SOLVER_SEARCH;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_level
+//
+//  Arguments:      none
+//
+//  Returns:        The number of rows in the new frontier (0 when the search
+//                  is over).
+//
+//  Description:    This function does one level of the breadth-first
+//                  search. The frontier is spread left and right by shifting
+//                  each word (with the bit carried in from the word next to
+//                  it), and up and down by ORing in the rows above and
+//                  below. Only the frontier rows and the rows next to them
+//                  can change, so only those are looked at (each row once,
+//                  using the row stamps). The old frontier rows are cleared
+//                  afterwards, so the buffer is empty when it is used for
+//                  the next frontier but one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int solver_level()
+{
+    unsigned long (*current)[SOLVER_WORDS] = solverFrontier[solverCurrent];
+    unsigned long (*next)[SOLVER_WORDS] = solverFrontier[solverCurrent ^ 1];
+    unsigned int *active = solverActive[solverCurrent];
+    unsigned int *nextActive = solverActive[solverCurrent ^ 1];
+    unsigned int distance = solverLevel + 1;
+    unsigned int candidates, count, k, base;
+    unsigned long spread, found, any;
+    int row, r, w;
+
+    // List the rows the frontier can spread into
+    candidates = 0;
+    for (k = 0; k < solverActiveCount; k++) {
+        for (r = (int)active[k] - 1; r <= (int)active[k] + 1; r++) {
+            if ((r >= 0) && (r < solverRows) &&
+                (solverRowStamp[r] != distance)) {
+                solverRowStamp[r] = distance;
+                solverCandidate[candidates++] = r;
+            }
+        }
+    }
+
+    // Spread the frontier, and give the tiles reached their distance
+    count = 0;
+    for (k = 0; k < candidates; k++) {
+        row = solverCandidate[k];
+        any = 0;
+
+        for (w = 0; w < solverWords; w++) {
+            spread = (current[row][w] << 1) | (current[row][w] >> 1);
+            if (w > 0) {
+                spread |= current[row][w - 1] >> 63;
+            }
+            if (w < solverWords - 1) {
+                spread |= current[row][w + 1] << 63;
+            }
+            if (row > 0) {
+                spread |= current[row - 1][w];
+            }
+            if (row < solverRows - 1) {
+                spread |= current[row + 1][w];
+            }
+
+            found = spread & solverPass[row][w] & ~solverSeen[row][w];
+            next[row][w] = found;
+            if (found == 0) {
+                continue;
+            }
+
+            solverSeen[row][w] |= found;
+            any = 1;
+
+            base = row * solverCols + w * 64;
+            while (found) {
+                solverDistance[base + __builtin_ctzl(found)] = distance;
+                found &= found - 1;
+            }
+        }
+
+        if (any) {
+            nextActive[count++] = row;
+        }
+    }
+
+    // Clear the old frontier
+    for (k = 0; k < solverActiveCount; k++) {
+        for (w = 0; w < solverWords; w++) {
+            current[active[k]][w] = 0;
+        }
+    }
+
+    solverCurrent ^= 1;
+    solverActiveCount = count;
+    solverLevel = distance;
+
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_repair
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the repair queue is not empty yet,
+//                  FALSE (zero) if the distance field is complete.
+//
+//  Description:    This function takes up to SOLVER_REPAIR_BATCH tiles from
+//                  the repair queue. Each tile gets the shortest distance
+//                  through its neighbours, and any neighbour that is now
+//                  closer to the exit through the tile is given its new
+//                  distance and queued in turn.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int solver_repair()
+{
+    unsigned int tile, distance;
+    int batch, row, col, i, neighbour;
+
+    for (batch = 0; batch < SOLVER_REPAIR_BATCH; batch++) {
+        if (solverQueueHead == solverQueueTail) {
+            return 0;
+        }
+
+        tile = solverQueue[solverQueueTail & (SOLVER_TILES - 1)];
+        solverQueueTail++;
+        solverRepairs++;
+
+        row = tile / solverCols;
+        col = tile - row * solverCols;
+
+        // Find the shortest way on through a neighbour
+        distance = solverDistance[tile];
+        for (i = 0; i < 4; i++) {
+            neighbour = solver_neighbour(row, col, i);
+            if ((neighbour >= 0) &&
+                (solverDistance[neighbour] != SOLVER_UNREACHED) &&
+                (solverDistance[neighbour] + 1 < distance)) {
+                distance = solverDistance[neighbour] + 1;
+            }
+        }
+        if (distance == SOLVER_UNREACHED) {
+            continue;
+        }
+        solverDistance[tile] = distance;
+
+        // Pass the new distance on
+        for (i = 0; i < 4; i++) {
+            neighbour = solver_neighbour(row, col, i);
+            if ((neighbour >= 0) &&
+                (solverDistance[neighbour] > distance + 1)) {
+                solverDistance[neighbour] = distance + 1;
+                solver_push(neighbour);
+            }
+        }
+    }
+
+    return solverQueueHead != solverQueueTail;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_open
+//
+//  Arguments:      row, col:     A tile that has become passable
+//
+//  Returns:        void
+//
+//  Description:    This function is called when a wall is destroyed. The
+//                  tile is marked as passable, and queued for the repair,
+//                  which is done once any search in progress is over.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void solver_open(int row, int col)
+{
+    if (solverState == SOLVER_IDLE) {
+        return;
+    }
+
+    solverPass[row][col >> 6] |= 0x1UL << (col & 63);
+    solver_push(row * solverCols + col);
+
+    if (solverState == SOLVER_DONE) {
+        solverState = SOLVER_REPAIR;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_update
+//
+//  Arguments:      budget:     The time the solver may run for, in
+//                              microseconds
+//
+//  Returns:        TRUE (non-zero) if the distance field is complete, FALSE
+//                  (zero) if there is still work to do.
+//
+//  Description:    This function is called once a frame. It builds, searches
+//                  and repairs in small steps until the distance field is
+//                  complete or the time is used up. Each step takes at most
+//                  a row of tiles, a level of the search, or a batch of the
+//                  repair queue, so the budget is overrun by very little.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_update(unsigned int budget)
+{
+    unsigned long start;
+
+    if ((solverState == SOLVER_IDLE) || (solverState == SOLVER_DONE)) {
+        return solverState == SOLVER_DONE;
+    }
+
+    start = get_timer_counter();
+    solverFrames++;
+
+    do {
+        if (solverRestart) {
+            solver_start();
+        }
+
+        switch (solverState) {
+            case SOLVER_BUILD:
+                solver_build_row();
+                break;
+            case SOLVER_SEARCH:
+                if (solver_level() == 0) {
+                    solverState = SOLVER_REPAIR;
+                }
+                break;
+            case SOLVER_REPAIR:
+                if (!solver_repair()) {
+                    solverState = SOLVER_DONE;
+                }
+                break;
+        }
+    } while ((solverState != SOLVER_DONE) &&
+             (get_timer_counter() - start < budget));
+
+    solverTime += get_timer_counter() - start;
+
+    return solverState == SOLVER_DONE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_ready
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the distance field is complete, FALSE
+//                  (zero) if not.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_ready()
+{
+    return solverState == SOLVER_DONE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_distance
+//
+//  Arguments:      row, col:     A tile inside the maze
+//
+//  Returns:        The number of steps from the tile to the exit, or
+//                  SOLVER_UNREACHED if the exit cannot be reached from it, or
+//                  the search has not reached it yet.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int solver_distance(int row, int col)
+{
+    if (solverState < SOLVER_SEARCH) {
+        return SOLVER_UNREACHED;
+    }
+
+    return solverDistance[row * solverCols + col];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_path
+//
+//  Arguments:      row, col:     The tile to start from
+//                  path:         Where to write the indices of the tiles of
+//                                the way to the exit (row * cols + col),
+//                                not including the start
+//                  max:          The most tiles to write
+//
+//  Returns:        The number of tiles written.
+//
+//  Description:    This function finds the first steps of the shortest way
+//                  from the tile to the exit. Once the search is over, each
+//                  step goes to the neighbour closest to the exit in the
+//                  distance field. While a repair is in progress, the
+//                  distances are never too short, so this still gets to
+//                  the exit, though maybe not by the shortest way. If the
+//                  tile is not in the distance field yet, A* is used.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_path(int row, int col, unsigned int *path, int max)
+{
+    unsigned int distance, best;
+    int count, i, neighbour, next;
+
+    if ((solverState != SOLVER_REPAIR) && (solverState != SOLVER_DONE)) {
+        return solver_astar(row, col, path, max);
+    }
+
+    distance = solverDistance[row * solverCols + col];
+    if (distance == SOLVER_UNREACHED) {
+        return solver_astar(row, col, path, max);
+    }
+
+    count = 0;
+    while ((distance > 0) && (count < max)) {
+        best = distance;
+        next = -1;
+        for (i = 0; i < 4; i++) {
+            neighbour = solver_neighbour(row, col, i);
+            if ((neighbour >= 0) && (solverDistance[neighbour] < best)) {
+                best = solverDistance[neighbour];
+                next = neighbour;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+
+        path[count++] = next;
+        distance = best;
+        row = next / solverCols;
+        col = next - row * solverCols;
+    }
+
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       astar_push
+//
+//  Arguments:      key:     The estimated length of the way through the tile
+//                           (in the top 32 bits) and the index of the tile
+//
+//  Returns:        TRUE (non-zero) if the key was added, FALSE (zero) if the
+//                  heap is full.
+//
+//  Description:    This function adds a key to the binary heap, moving it up
+//                  past every parent with a larger key.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int astar_push(unsigned long key)
+{
+    unsigned int i, parent;
+
+    if (astarHeapSize == SOLVER_HEAP_SIZE) {
+        return 0;
+    }
+
+    i = astarHeapSize++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (astarHeap[parent] <= key) {
+            break;
+        }
+        astarHeap[i] = astarHeap[parent];
+        i = parent;
+    }
+    astarHeap[i] = key;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       astar_pop
+//
+//  Arguments:      none
+//
+//  Returns:        The smallest key in the heap (which must not be empty).
+//
+//  Description:    This function removes the smallest key from the heap. The
+//                  last key takes its place, and is moved down past every
+//                  child with a smaller key.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long astar_pop()
+{
+    unsigned long top = astarHeap[0];
+    unsigned long key = astarHeap[--astarHeapSize];
+    unsigned int i, child;
+
+    i = 0;
+    while ((child = 2 * i + 1) < astarHeapSize) {
+        if ((child + 1 < astarHeapSize) &&
+            (astarHeap[child + 1] < astarHeap[child])) {
+            child++;
+        }
+        if (key <= astarHeap[child]) {
+            break;
+        }
+        astarHeap[i] = astarHeap[child];
+        i = child;
+    }
+    astarHeap[i] = key;
+
+    return top;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_astar
+//
+//  Arguments:      row, col:     The tile to start from
+//                  path:         Where to write the indices of the tiles of
+//                                the way to the exit, not including the start
+//                  max:          The most tiles to write
+//
+//  Returns:        The number of tiles written, or 0 if there is no way to
+//                  the exit, the exit is not known yet, or the search gave up.
+//
+//  Description:    This function finds the shortest way from the tile to the
+//                  exit with A*. The Manhattan distance to the exit never
+//                  overestimates, and changes by 1 with every step, so the
+//                  first time a tile is taken from the heap its cost is
+//                  final. A tile whose cost improves is added to the heap
+//                  again, and its old, larger key is skipped when it comes
+//                  out. The way is traced back from the exit by stepping to
+//                  a neighbour whose cost is one less.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_astar(int row, int col, unsigned int *path, int max)
+{
+    unsigned int goalRow, goalCol, tile, cost, length, k;
+    unsigned long key;
+    int expanded, i, neighbour, found;
+
+    if ((solverState < SOLVER_SEARCH) || (solverExit < 0)) {
+        return 0;
+    }
+    solverAstarRuns++;
+
+    astarHeap = arena_alloc(&heapFrameArena, SOLVER_HEAP_SIZE * sizeof(unsigned long), HEAP_ALIGN);
+    if (astarHeap == 0) {
+        solverAstarFailures++;
+        return 0;
+    }
+
+    goalRow = solverExit / solverCols;
+    goalCol = solverExit - goalRow * solverCols;
+
+    // Start a new search, clearing the stamps when they run out
+    if (++astarEpoch == 0) {
+        for (k = 0; k < SOLVER_TILES; k++) {
+            astarStamp[k] = 0;
+        }
+        astarEpoch = 1;
+    }
+
+    tile = row * solverCols + col;
+    astarStamp[tile] = astarEpoch;
+    astarCost[tile] = 0;
+    astarHeapSize = 0;
+    astar_push(((unsigned long)(__builtin_abs(row - (int)goalRow) +
+                                __builtin_abs(col - (int)goalCol)) << 32) | tile);
+
+    found = 0;
+    expanded = 0;
+    while (astarHeapSize) {
+        key = astar_pop();
+        tile = (unsigned int)key;
+        row = tile / solverCols;
+        col = tile - row * solverCols;
+
+        // Skip the key if the tile has been reached by a shorter way since
+        cost = astarCost[tile];
+        if ((key >> 32) != cost + __builtin_abs(row - (int)goalRow) +
+                           __builtin_abs(col - (int)goalCol)) {
+            continue;
+        }
+
+        if (tile == (unsigned int)solverExit) {
+            found = 1;
+            break;
+        }
+
+        if (++expanded > SOLVER_ASTAR_LIMIT) {
+            break;
+        }
+
+        for (i = 0; i < 4; i++) {
+            neighbour = solver_neighbour(row, col, i);
+            if ((neighbour < 0) ||
+                ((astarStamp[neighbour] == astarEpoch) &&
+                 (astarCost[neighbour] <= cost + 1))) {
+                continue;
+            }
+
+            astarStamp[neighbour] = astarEpoch;
+            astarCost[neighbour] = cost + 1;
+            key = (unsigned long)(cost + 1 +
+                  __builtin_abs(row + solverRowStep[i] - (int)goalRow) +
+                  __builtin_abs(col + solverColStep[i] - (int)goalCol));
+            if (!astar_push((key << 32) | neighbour)) {
+                astarHeapSize = 0;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        solverAstarFailures++;
+        return 0;
+    }
+
+    // Trace the way back from the exit
+    length = astarCost[tile];
+    for (k = length; k > 0; k--) {
+        if (k <= (unsigned int)max) {
+            path[k - 1] = tile;
+        }
+
+        row = tile / solverCols;
+        col = tile - row * solverCols;
+        for (i = 0; i < 4; i++) {
+            neighbour = solver_neighbour(row, col, i);
+            if ((neighbour >= 0) && (astarStamp[neighbour] == astarEpoch) &&
+                (astarCost[neighbour] == k - 1)) {
+                tile = neighbour;
+                break;
+            }
+        }
+    }
+
+    return length < (unsigned int)max ? length : max;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the state of the solver to the
+//                  console: the frames and time (in microseconds) taken to
+//                  solve the current maze so far, the levels searched, the
+//                  tiles repaired, the A* searches run and given up, and the
+//                  distance from the player to the exit. All values are
+//                  hexadecimal.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void solver_report()
+{
+    uart_puts("\nSolver report:\n");
+    uart_puts("    ready:  0x");
+    uart_puthex(solver_ready());
+    uart_puts("\n    frames:  0x");
+    uart_puthex(solverFrames);
+    uart_puts("\n    time us:  0x");
+    uart_puthex((unsigned int)solverTime);
+    uart_puts("\n    levels:  0x");
+    uart_puthex(solverLevel);
+    uart_puts("\n    repaired:  0x");
+    uart_puthex(solverRepairs);
+    uart_puts("\n    astar runs:  0x");
+    uart_puthex(solverAstarRuns);
+    uart_puts("\n    astar failures:  0x");
+    uart_puthex(solverAstarFailures);
+    uart_puts("\n    player distance:  0x");
+    uart_puthex(solver_distance(game.playerRow, game.playerCol));
+    uart_puts("\n");
+}
@@ -0,0 +1,29 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+// Definitions and function prototypes for the maze solver in solver.c
+
+// Default time the solver may run for in each frame, in microseconds
+#define SOLVER_FRAME_BUDGET     4000
+
+// Number of steps of the way to the exit shown by the hint
+#define SOLVER_HINT_STEPS       8
+
+// The largest number of tiles A* looks at before it gives up
+#define SOLVER_ASTAR_LIMIT      20000
+
+// Distance of a tile from which the exit cannot be reached (or not yet
+// known to be reachable)
+#define SOLVER_UNREACHED        0xFFFFFFFF
+
+// Function prototypes
+void solver_start();
+void solver_open(int row, int col);
+int solver_update(unsigned int budget);
+int solver_ready();
+unsigned int solver_distance(int row, int col);
+int solver_path(int row, int col, unsigned int *path, int max);
+int solver_astar(int row, int col, unsigned int *path, int max);
+void solver_report();
+
+#endif
@@ -0,0 +1,125 @@
+// The functions in this file implement a simple driver for the SPI0 master
+// of the BCM2837. Transfers are started with spi_start(), which returns at
+// once, so that the CPU can do other work while the bytes are shifted by the
+// hardware. The caller then checks for completion with spi_done(), and
+// collects the received bytes from the receive FIFO with spi_finish().
+//
+// Only transfers that fit in the FIFOs (up to SPI_FIFO_SIZE bytes) are
+// supported, so the FIFOs never need to be serviced during a transfer. The
+// pins are not changed here: the caller must select the ALT0 function of
+// the SPI0 pins that it uses (normally with gpio_configure()).
+
+// Header files
+#include "spi.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spi_init
+//
+//  Arguments:      divider:    The core clock divider (an even number)
+//                  mode:       SPI_MODE0 - SPI_MODE3
+//
+//  Returns:        void
+//
+//  Description:    This function sets the SPI clock rate and mode, clears
+//                  both FIFOs, and leaves the interface idle (TA is 0). The
+//                  SPI clock is the 250 MHz core clock divided by the
+//                  divider, and is held at the idle level given by CPOL
+//                  while no transfer is active.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spi_init(unsigned int divider, unsigned int mode)
+{
+    *SPI0_CS = SPI_CS_CLEAR_TX | SPI_CS_CLEAR_RX;
+    *SPI0_CLK = divider & 0xFFFE;
+    *SPI0_CS = mode & SPI_MODE3;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spi_start
+//
+//  Arguments:      count:    The number of bytes to transfer (at most
+//                            SPI_FIFO_SIZE)
+//
+//  Returns:        void
+//
+//  Description:    This function starts a transfer of count bytes, and
+//                  returns without waiting for it to finish. The FIFOs are
+//                  cleared, the Transfer Active bit is set, and a zero byte
+//                  is written to the transmit FIFO for each byte to be
+//                  received. The hardware then shifts out the bytes, and
+//                  sets the DONE bit once the transmit FIFO is empty.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spi_start(unsigned int count)
+{
+    unsigned int i;
+
+    if (count > SPI_FIFO_SIZE) {
+        count = SPI_FIFO_SIZE;
+    }
+
+    *SPI0_CS = (*SPI0_CS & SPI_MODE3) | SPI_CS_CLEAR_TX | SPI_CS_CLEAR_RX
+               | SPI_CS_TA;
+
+    for (i = 0; i < count; i++) {
+        *SPI0_FIFO = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spi_done
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the transfer has finished, FALSE (zero)
+//                  if it is still in progress.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int spi_done()
+{
+    return (*SPI0_CS & SPI_CS_DONE) != 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spi_finish
+//
+//  Arguments:      rx:       An array to copy the received bytes into
+//                  count:    The number of bytes that were transferred
+//
+//  Returns:        void
+//
+//  Description:    This function waits for the transfer to finish (it has
+//                  normally finished already, see spi_done()), copies the
+//                  received bytes out of the receive FIFO, and ends the
+//                  transfer by clearing the Transfer Active bit.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spi_finish(unsigned char *rx, unsigned int count)
+{
+    unsigned int i;
+
+    while (!spi_done())
+        ;
+
+    for (i = 0; i < count && i < SPI_FIFO_SIZE; i++) {
+        rx[i] = (unsigned char)*SPI0_FIFO;
+    }
+
+    *SPI0_CS &= ~SPI_CS_TA;
+}
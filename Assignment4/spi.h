@@ -0,0 +1,44 @@
+#ifndef SPI_H
+#define SPI_H
+
+// The addresses of the SPI0 registers.
+//
+// These are defined on page 152 of the Broadcom BCM2837 ARM Peripherals
+// Manual. The SPI0 signals are the ALT0 functions of GPIO pins 7 (CE1),
+// 8 (CE0), 9 (MISO), 10 (MOSI), and 11 (SCLK).
+
+#include "gpio.h"
+
+#define SPI0_CS         ((volatile unsigned int *)(MMIO_BASE + 0x00204000))
+#define SPI0_FIFO       ((volatile unsigned int *)(MMIO_BASE + 0x00204004))
+#define SPI0_CLK        ((volatile unsigned int *)(MMIO_BASE + 0x00204008))
+#define SPI0_DLEN       ((volatile unsigned int *)(MMIO_BASE + 0x0020400C))
+#define SPI0_LTOH       ((volatile unsigned int *)(MMIO_BASE + 0x00204010))
+#define SPI0_DC         ((volatile unsigned int *)(MMIO_BASE + 0x00204014))
+
+// Bits in the SPI0 Control and Status register
+#define SPI_CS_CPHA         (0x1 << 2)
+#define SPI_CS_CPOL         (0x1 << 3)
+#define SPI_CS_CLEAR_TX     (0x1 << 4)
+#define SPI_CS_CLEAR_RX     (0x1 << 5)
+#define SPI_CS_TA           (0x1 << 7)
+#define SPI_CS_DONE         (0x1 << 16)
+#define SPI_CS_RXD          (0x1 << 17)
+#define SPI_CS_TXD          (0x1 << 18)
+
+// SPI modes (the CPOL and CPHA bits of the CS register)
+#define SPI_MODE0       0
+#define SPI_MODE1       SPI_CS_CPHA
+#define SPI_MODE2       SPI_CS_CPOL
+#define SPI_MODE3       (SPI_CS_CPOL | SPI_CS_CPHA)
+
+// The number of bytes in the transmit and receive FIFOs
+#define SPI_FIFO_SIZE   16
+
+// Function prototypes
+void spi_init(unsigned int divider, unsigned int mode);
+void spi_start(unsigned int count);
+int spi_done();
+void spi_finish(unsigned char *rx, unsigned int count);
+
+#endif
@@ -1,6 +1,7 @@
 // This routine is used to establish an environment in which
 // a C program can run. We create this environment only on
-// CPU Core 0. The other cores simply run an infinite loop.
+// CPU Core 0. The other cores wait until they are started by
+// smp_start() in common/smp.c.
 //
 // The stack pointer register is initialized to point
 // just below the text section of the program. It grows
@@ -12,9 +13,15 @@
 // should never return to this code (it should be in
 // an infinite loop), but if it does, we then put the
 // CPU Core 0 into an infinite loop.
-	
-	
-	// Put the machine code for this routine into the .text.boot section	
+//
+// This version of the start routine also changes the exception
+// level from EL2 to EL1 (in the aarch64 execution state), and
+// sets up the exception vector table, so that the sampling
+// profiler can be driven by a timer interrupt. The vector table
+// and the exception stubs are in common/vectors.s.
+
+
+	// Put the machine code for this routine into the .text.boot section
 	.section ".text.boot"
 
 	// The _start symbol needs to be visible to the linker
@@ -31,21 +38,100 @@ _start:
 	tst	x1, 0x3		// Bitwise AND rightmost 2 bits
 	b.eq	core_zero	// Skip forward if both bits are 0
 
-	//  If here, the CPU Core number is not 0, so loop forever
+	//  If here, the CPU Core number is not 0. If the firmware started
+	//  this core here as well, it waits until smp_start() (see
+	//  common/smp.c) writes an entry address to its spin table slot at
+	//  0xD8 + 8 * core number, and then jumps to it.
+	and	x1, x1, 0x3
+	mov	x2, 0xD8
+	add	x2, x2, x1, lsl 3
+spin:	ldr	x3, [x2]	// Read the spin table slot
+	cbnz	x3, released	// Leave the loop once it is set
+	wfe			// Wait for event
+	b	spin
+released:
+	br	x3
+
+	//  Infinite loop, used if main() returns
 loop:  	wfe			// Wait for event
 	b	loop		// Infinite loop
 
-  	// If here, the CPU Core is 0, and we run the rest of the program
+  	// If here, the CPU Core is 0, and we continue with the rest of the setup.
+	// We are running in EL2 currently, and will change to EL1 below.
 core_zero:
 
 	// Set the stack pointer to point to where the _start routine
 	// begins. The stack grows backwards (towards 0), so it uses memory
 	// that has lower addresses than the _start routine. We need to
 	// set this properly so that C functions and assembly routines
-	// can allocate stack frames.
+	// can allocate stack frames. The program itself runs on the EL0 SP,
+	// which is set below once we have changed to EL1. Exception handlers
+	// run on the EL1 SP, so we give it its own stack 128 KB further
+	// down, where it cannot overwrite the stack frames of the program.
 	adrp	x1, _start	// Put the _start address into x1
 	add	x1, x1, :lo12:_start
-	mov     sp, x1		// Copy the address into the sp register
+	sub	x2, x1, 0x20000	// Exception stack starts 128 KB lower
+	msr	sp_el1, x2	// Copy the address into the EL1 SP register
+
+	// Enable AArch64 in EL1 by setting bits RW and SWIC to 1 in the
+	// Hypervisor Configuration Register (see p. D10-2492 and D10-2503
+	// in the ARM Architecture Reference Manual). Since all other bits
+	// are 0, most instructions are not trapped, and the Physical SError,
+	// IRQ, and FIQ routings are set so that these exceptions are not
+	// taken to EL2, but are handled at EL1.
+	mov	x0, (1 << 31)		// Enable AArch64
+	orr	x0, x0, (1 << 1)	// SWIO is hardwired on the Pi3
+	msr	hcr_el2, x0
+
+	// Give EL1 access to all of the PMU event counters, by setting the
+	// HPMN field of the Monitor Debug Configuration Register (EL2) to the
+	// number of counters implemented (the N field of PMCR_EL0). All other
+	// bits are 0, so PMU accesses are not trapped to EL2.
+	mrs	x0, pmcr_el0
+	ubfx	x0, x0, 11, 5
+	msr	mdcr_el2, x0
+
+	// Let EL1 read the physical counter and use the physical timer, by
+	// setting the EL1PCTEN and EL1PCEN bits of the Counter-timer
+	// Hypervisor Control Register, and make the virtual counter equal
+	// to the physical counter. Each core's physical timer is driven by
+	// common/localtimer.c.
+	mov	x0, 0x3
+	msr	cnthctl_el2, x0
+	msr	cntvoff_el2, xzr
+
+	// Set the Vector Base Address Register (EL1) to the address
+	// of the vectors defined in common/vectors.s
+	adrp	x2, _vectors
+	add	x2, x2, :lo12:_vectors
+	msr     vbar_el1, x2
+
+	// Change execution level to EL1:
+	//
+	// Set the Saved Program Status Register so that when entering
+	// EL1, the DAIF bits are set to 1111 (exceptions are masked) and
+	// the M[3:2] bits are set to 01 (EL1) and the M[0] bit is set
+	// to 0 (SP is always SP0) (see p. C5-386-387 in the ARM
+	// Architecture Reference Manual).
+	mov	x2, 0x3C4
+	msr	spsr_el2, x2
+
+	// Set the Exception Link Register EL2 to the address of
+	// the instruction labelled AtEL1 (a few lines down). We
+	// will jump to this instruction when executing the
+	// exception return instruction.
+	adr	x2, AtEL1
+	msr	elr_el2, x2
+
+	// Executing a return from exception forces the processor to
+	// change to EL1. We then jump to the instruction at the
+	// label below.
+	eret
+
+
+	// Set the current SP to the _start address, as
+	// described above. This will be sp_el0.
+AtEL1:	mov	sp, x1
 
 	// Clear the .bss section using a loop. The __bss_start
 	// symbol is provided by the linker, and is the address in
@@ -62,7 +148,7 @@ top:	cbz     w2, endloop		// Exit loop if counter == 0
 	str     xzr, [x1], 8		// Write zeroes to RAM, x1 += 8
 	sub     w2, w2, 1		// Decrement counter (w2)
 	cbnz    w2, top			// Keep looping while counter != 0
-endloop:	
+endloop:
 
 	// Branch to the main() routine, which should never return
   	bl      main
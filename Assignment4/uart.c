@@ -215,6 +215,29 @@ char uart_getc()
 
 
  
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_rx_ready
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a character has been received and can
+//                  be read with uart_getc() without waiting, FALSE (zero)
+//                  otherwise.
+//
+//  Description:    This function checks the Data Ready bit (bit 0) in the
+//                  Mini UART Line Status Register, without blocking. It lets
+//                  a program poll for console commands in its main loop.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int uart_rx_ready()
+{
+    return (*AUX_MU_LSR & 0x1);
+}
+
+
+ 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Function:       uart_puts
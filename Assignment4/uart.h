@@ -3,5 +3,6 @@
 void uart_init();
 void uart_putc(unsigned int c);
 char uart_getc();
+unsigned int uart_rx_ready();
 void uart_puts(char *s);
 void uart_puthex(unsigned int value);
@@ -0,0 +1,184 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+// Atomic operations on 32-bit and 64-bit values shared between cores.
+//
+// Loads with acquire order (LDAR) are not moved after later accesses, and
+// stores with release order (STLR) are not moved before earlier accesses,
+// so a value published with a release store is seen complete by a core
+// that reads it with an acquire load. The read-modify-write operations are
+// both acquire and release. They use a load-exclusive / store-exclusive
+// loop (LDAXR / STLXR), which is retried if another core wrote the value
+// in between, or the single ARMv8.1 LSE instructions (LDADDAL, SWPAL,
+// CASAL) when the compiler targets a core that has them.
+//
+// The atomics only work on normal cacheable memory, so the MMU must be on
+// (see mmu.c). The functions are defined here, in the header, so that
+// they are inlined.
+
+// Memory barrier between all loads and stores of the cores
+static inline void atomic_fence()
+{
+    asm volatile("dmb ish" : : : "memory");
+}
+
+static inline unsigned int atomic_load_acquire(volatile unsigned int *p)
+{
+    unsigned int value;
+
+    asm volatile("ldar %w0, [%1]" : "=r" (value) : "r" (p) : "memory");
+    return value;
+}
+
+static inline unsigned long atomic_load_acquire64(volatile unsigned long *p)
+{
+    unsigned long value;
+
+    asm volatile("ldar %0, [%1]" : "=r" (value) : "r" (p) : "memory");
+    return value;
+}
+
+static inline void atomic_store_release(volatile unsigned int *p, unsigned int value)
+{
+    asm volatile("stlr %w0, [%1]" : : "r" (value), "r" (p) : "memory");
+}
+
+static inline void atomic_store_release64(volatile unsigned long *p, unsigned long value)
+{
+    asm volatile("stlr %0, [%1]" : : "r" (value), "r" (p) : "memory");
+}
+
+#ifdef __ARM_FEATURE_ATOMICS
+
+static inline unsigned int atomic_fetch_add(volatile unsigned int *p, unsigned int value)
+{
+    unsigned int old;
+
+    asm volatile("ldaddal %w1, %w0, [%2]"
+                 : "=r" (old) : "r" (value), "r" (p) : "memory");
+    return old;
+}
+
+static inline unsigned long atomic_fetch_add64(volatile unsigned long *p, unsigned long value)
+{
+    unsigned long old;
+
+    asm volatile("ldaddal %1, %0, [%2]"
+                 : "=r" (old) : "r" (value), "r" (p) : "memory");
+    return old;
+}
+
+static inline unsigned int atomic_exchange(volatile unsigned int *p, unsigned int value)
+{
+    unsigned int old;
+
+    asm volatile("swpal %w1, %w0, [%2]"
+                 : "=r" (old) : "r" (value), "r" (p) : "memory");
+    return old;
+}
+
+static inline int atomic_compare_exchange(volatile unsigned int *p,
+                                          unsigned int expected,
+                                          unsigned int desired)
+{
+    unsigned int old = expected;
+
+    asm volatile("casal %w0, %w1, [%2]"
+                 : "+r" (old) : "r" (desired), "r" (p) : "memory");
+    return old == expected;
+}
+
+static inline int atomic_compare_exchange64(volatile unsigned long *p,
+                                            unsigned long expected,
+                                            unsigned long desired)
+{
+    unsigned long old = expected;
+
+    asm volatile("casal %0, %1, [%2]"
+                 : "+r" (old) : "r" (desired), "r" (p) : "memory");
+    return old == expected;
+}
+
+#else
+
+static inline unsigned int atomic_fetch_add(volatile unsigned int *p, unsigned int value)
+{
+    unsigned int old, sum, failed;
+
+    asm volatile("1:    ldaxr   %w0, [%3]\n"
+                 "      add     %w1, %w0, %w4\n"
+                 "      stlxr   %w2, %w1, [%3]\n"
+                 "      cbnz    %w2, 1b\n"
+                 : "=&r" (old), "=&r" (sum), "=&r" (failed)
+                 : "r" (p), "r" (value) : "memory");
+    return old;
+}
+
+static inline unsigned long atomic_fetch_add64(volatile unsigned long *p, unsigned long value)
+{
+    unsigned long old, sum;
+    unsigned int failed;
+
+    asm volatile("1:    ldaxr   %0, [%3]\n"
+                 "      add     %1, %0, %4\n"
+                 "      stlxr   %w2, %1, [%3]\n"
+                 "      cbnz    %w2, 1b\n"
+                 : "=&r" (old), "=&r" (sum), "=&r" (failed)
+                 : "r" (p), "r" (value) : "memory");
+    return old;
+}
+
+static inline unsigned int atomic_exchange(volatile unsigned int *p, unsigned int value)
+{
+    unsigned int old, failed;
+
+    asm volatile("1:    ldaxr   %w0, [%2]\n"
+                 "      stlxr   %w1, %w3, [%2]\n"
+                 "      cbnz    %w1, 1b\n"
+                 : "=&r" (old), "=&r" (failed)
+                 : "r" (p), "r" (value) : "memory");
+    return old;
+}
+
+static inline int atomic_compare_exchange(volatile unsigned int *p,
+                                          unsigned int expected,
+                                          unsigned int desired)
+{
+    unsigned int old, failed;
+
+    asm volatile("1:    ldaxr   %w0, [%2]\n"
+                 "      cmp     %w0, %w3\n"
+                 "      b.ne    2f\n"
+                 "      stlxr   %w1, %w4, [%2]\n"
+                 "      cbnz    %w1, 1b\n"
+                 "      b       3f\n"
+                 "2:    clrex\n"
+                 "3:\n"
+                 : "=&r" (old), "=&r" (failed)
+                 : "r" (p), "r" (expected), "r" (desired) : "memory", "cc");
+    return old == expected;
+}
+
+static inline int atomic_compare_exchange64(volatile unsigned long *p,
+                                            unsigned long expected,
+                                            unsigned long desired)
+{
+    unsigned long old;
+    unsigned int failed;
+
+    asm volatile("1:    ldaxr   %0, [%2]\n"
+                 "      cmp     %0, %3\n"
+                 "      b.ne    2f\n"
+                 "      stlxr   %w1, %4, [%2]\n"
+                 "      cbnz    %w1, 1b\n"
+                 "      b       3f\n"
+                 "2:    clrex\n"
+                 "3:\n"
+                 : "=&r" (old), "=&r" (failed)
+                 : "r" (p), "r" (expected), "r" (desired) : "memory", "cc");
+    return old == expected;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+// The functions in this file handle the exceptions other than IRQs and
+// FIQs, for both kernels. The exception stub in vectors.s calls
+// exception_handler() with the registers of the interrupted code, and the
+// number of the vector that was taken. The handler decodes the Exception
+// Syndrome Register (ESR_EL1) and writes a report to the console, with the
+// Fault Address Register (FAR_EL1) and the address of the instruction that
+// caused the exception (ELR_EL1), which can be looked up in kernel8.dump.
+//
+// An SVC or BRK instruction is resumed after the report. Every other
+// exception is a bug, so the core is stopped with all exceptions masked.
+
+// Header files
+#include "uart.h"
+#include "exceptions.h"
+
+// Names of the vector groups and of the exception types, by vector number
+char *exceptionSource[4] =
+    {
+        "current EL, SP_EL0", "current EL, SP_ELx",
+        "lower EL, AArch64", "lower EL, AArch32"
+    };
+
+char *exceptionType[4] =
+    {
+        "synchronous", "IRQ", "FIQ", "SError"
+    };
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       exception_class_name
+//
+//  Arguments:      class:     The exception class (bits 26 to 31 of ESR_EL1)
+//
+//  Returns:        A short description of the exception class.
+//
+//  Description:    The classes are listed in section D10.2.39 of the ARM
+//                  Architecture Reference Manual. Only the classes that
+//                  can be taken to EL1 by these kernels are named.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static char *exception_class_name(unsigned int class)
+{
+    switch (class) {
+    case 0x00:
+        return "unknown reason";
+    case 0x01:
+        return "trapped WFI or WFE";
+    case 0x07:
+        return "trapped FP or SIMD access";
+    case 0x0E:
+        return "illegal execution state";
+    case ESR_CLASS_SVC:
+        return "SVC instruction";
+    case 0x18:
+        return "trapped MSR, MRS, or system instruction";
+    case 0x20:
+    case 0x21:
+        return "instruction abort";
+    case 0x22:
+        return "PC alignment fault";
+    case 0x24:
+    case 0x25:
+        return "data abort";
+    case 0x26:
+        return "SP alignment fault";
+    case 0x2F:
+        return "SError interrupt";
+    case ESR_CLASS_BRK:
+        return "BRK instruction";
+    default:
+        return "other";
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       exception_handler
+//
+//  Arguments:      frame:      The registers saved by the exception stub
+//                  vector:     The number of the vector taken (0 to 15)
+//
+//  Returns:        void, and only if the exception can be resumed.
+//
+//  Description:    This function writes a report of the exception to the
+//                  console. The exception syndrome is only meaningful for
+//                  synchronous exceptions and SErrors. A BRK instruction is
+//                  skipped, so that it can be used as a breakpoint that
+//                  prints the registers and continues. The return address
+//                  of an SVC instruction is already the next instruction.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void exception_handler(unsigned long *frame, unsigned int vector)
+{
+    unsigned long esr, far;
+    unsigned int class;
+
+    asm volatile("mrs %0, esr_el1" : "=r" (esr));
+    asm volatile("mrs %0, far_el1" : "=r" (far));
+    class = (esr >> 26) & 0x3F;
+
+    uart_puts("\nException report:\n    type:  ");
+    uart_puts(exceptionType[vector & 3]);
+    uart_puts("\n    from:  ");
+    uart_puts(exceptionSource[(vector >> 2) & 3]);
+    uart_puts("\n    class:  ");
+    uart_puts(exception_class_name(class));
+    uart_puts("\n    ESR_EL1:  0x");
+    uart_puthex(esr);
+    uart_puts("\n    FAR_EL1:  0x");
+    uart_puthex(far >> 32);
+    uart_puthex(far);
+    uart_puts("\n    ELR_EL1:  0x");
+    uart_puthex(frame[FRAME_ELR]);
+    uart_puts("\n    SPSR_EL1:  0x");
+    uart_puthex(frame[FRAME_SPSR]);
+    uart_puts("\n    x30:  0x");
+    uart_puthex(frame[FRAME_X30]);
+    uart_puts("\n");
+
+    if (((vector & 3) == 0) && (vector < 12)) {
+        if (class == ESR_CLASS_SVC) {
+            return;
+        }
+        if (class == ESR_CLASS_BRK) {
+            frame[FRAME_ELR] += 4;
+            return;
+        }
+    }
+
+    // The exception cannot be resumed, so stop this core
+    uart_puts("Core stopped.\n");
+    asm volatile("msr DAIFSet, 0b1111");
+    while (1) {
+        asm volatile("wfe");
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef EXCEPTIONS_H
+#define EXCEPTIONS_H
+
+// Definitions and function prototypes for the exception handlers in
+// exceptions.c, and the exception stubs in vectors.s
+
+// Layout of the frame saved by the exception stubs in vectors.s, in 64-bit
+// words: x0 to x18 are at index 0 to 18, followed by x29, x30, ELR_EL1,
+// and SPSR_EL1. The last word is padding.
+#define FRAME_X29               19
+#define FRAME_X30               20
+#define FRAME_ELR               21
+#define FRAME_SPSR              22
+#define FRAME_SIZE              24
+
+// Exception classes (bits 26 to 31 of ESR_EL1) that can be resumed
+#define ESR_CLASS_SVC           0x15
+#define ESR_CLASS_BRK           0x3C
+
+// Function prototypes
+void exception_handler(unsigned long *frame, unsigned int vector);
+
+#endif
@@ -0,0 +1,489 @@
+// The functions in this file manage the free RAM after the kernel image,
+// from the _end symbol of link.ld up to the end of the ARM memory (given by
+// the firmware, see TAG_GET_ARM_MEMORY). There are three kinds of
+// allocator, and every allocation and free takes constant time:
+//
+//   - Arenas, which give out memory from the bottom up, and are emptied all
+//     at once by resetting them to a mark. They suit scratch memory that
+//     only lives for one frame or one operation.
+//   - Pools of objects of one size, such as events or DMA control blocks,
+//     kept on a free list.
+//   - A general allocator, heap_alloc(), which rounds every request up to a
+//     power of 2 and keeps a free list for each size. A block is never
+//     split or merged, so up to half of it may be unused, but finding a
+//     block is one count leading zeros and one list pop.
+//
+// The general allocator takes new blocks from the heap arena, which covers
+// all the free RAM. The memory of other arenas and of pools can be taken
+// from heap_alloc() or from another arena. None of the allocators have
+// locks, so each one must only be used by one core, and not by interrupt
+// handlers. The memory is cached, so memory read by the GPU or a DMA
+// engine must be written back with mmu_clean() (see mmu.c).
+
+// Header files
+#include "uart.h"
+#include "heap.h"
+
+// The header in front of every block of heap_alloc(): the size of the
+// block as a power of 2 (with HEAP_BLOCK_FREE set while it is free), and the
+// next free block while it is free
+#define HEAP_BLOCK_FREE     (1UL << 63)
+
+struct heap_block {
+    unsigned long shift;
+    struct heap_block *next;
+};
+
+// The end of the kernel image, from link.ld
+extern char _end[];
+
+// Heap global variables: the arena covering the free RAM, the frame arena,
+// the free list of each block size, and the statistics of heap_alloc()
+struct arena heapArena;
+struct arena heapFrameArena;
+struct heap_block *heapFree[HEAP_CLASSES];
+unsigned int heapFreeCount[HEAP_CLASSES];
+unsigned long heapAllocs, heapFrees, heapFailures, heapBadFrees;
+unsigned long heapInUse, heapInUseHigh;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_init
+//
+//  Arguments:      arena:      The arena
+//                  memory:     The memory it gives out
+//                  size:       The size of the memory, in bytes
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void arena_init(struct arena *arena, void *memory, unsigned long size)
+{
+    arena->start = (unsigned long)memory;
+    arena->top = arena->start;
+    arena->end = arena->start + size;
+    arena->high = arena->start;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_alloc
+//
+//  Arguments:      arena:     The arena
+//                  size:      The number of bytes needed
+//                  align:     The alignment of the memory (a power of 2)
+//
+//  Returns:        A pointer to the memory, or 0 if the arena is full.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *arena_alloc(struct arena *arena, unsigned long size, unsigned long align)
+{
+    unsigned long start = (arena->top + align - 1) & ~(align - 1);
+
+    if ((start < arena->top) || (size > arena->end - start)) {
+        return 0;
+    }
+
+    arena->top = start + size;
+    if (arena->top > arena->high) {
+        arena->high = arena->top;
+    }
+
+    return (void *)start;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_mark
+//
+//  Arguments:      arena:     The arena
+//
+//  Returns:        A mark to pass to arena_reset().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long arena_mark(struct arena *arena)
+{
+    return arena->top;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_reset
+//
+//  Arguments:      arena:     The arena
+//                  mark:      A mark from arena_mark()
+//
+//  Returns:        void
+//
+//  Description:    This function frees all the memory given out since the
+//                  mark was taken.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void arena_reset(struct arena *arena, unsigned long mark)
+{
+    if ((mark >= arena->start) && (mark <= arena->top)) {
+        arena->top = mark;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_report
+//
+//  Arguments:      name:      The name of the arena
+//                  arena:     The arena
+//
+//  Returns:        void
+//
+//  Description:    This function writes the size of the arena, and the
+//                  number of bytes used now and at most, to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void arena_report(char *name, struct arena *arena)
+{
+    uart_puts("    ");
+    uart_puts(name);
+    uart_puts(" size:  0x");
+    uart_puthex(arena->end - arena->start);
+    uart_puts(", used:  0x");
+    uart_puthex(arena->top - arena->start);
+    uart_puts(", most used:  0x");
+    uart_puthex(arena->high - arena->start);
+    uart_puts("\n");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_init
+//
+//  Arguments:      pool:       The pool
+//                  memory:     The memory of the objects, aligned as the
+//                              objects need
+//                  size:       The size of an object, in bytes (rounded up
+//                              to a multiple of 8)
+//                  count:      The number of objects
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pool_init(struct pool *pool, void *memory, unsigned long size, unsigned int count)
+{
+    size = (size + 7) & ~7UL;
+
+    pool->free = 0;
+    pool->next = (unsigned long)memory;
+    pool->end = pool->next + size * count;
+    pool->size = size;
+    pool->used = 0;
+    pool->high = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_alloc
+//
+//  Arguments:      pool:     The pool
+//
+//  Returns:        A pointer to an object, or 0 if all the objects are used.
+//
+//  Description:    This function takes the last object freed, or else the
+//                  next object that has never been used.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *pool_alloc(struct pool *pool)
+{
+    void *object;
+
+    if (pool->free) {
+        object = pool->free;
+        pool->free = *(void **)object;
+    } else if (pool->next < pool->end) {
+        object = (void *)pool->next;
+        pool->next += pool->size;
+    } else {
+        return 0;
+    }
+
+    pool->used++;
+    if (pool->used > pool->high) {
+        pool->high = pool->used;
+    }
+
+    return object;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_free
+//
+//  Arguments:      pool:       The pool
+//                  object:     An object from pool_alloc(), or 0
+//
+//  Returns:        void
+//
+//  Description:    The first 8 bytes of a free object hold the next free
+//                  object.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pool_free(struct pool *pool, void *object)
+{
+    if (object == 0) {
+        return;
+    }
+
+    *(void **)object = pool->free;
+    pool->free = object;
+    pool->used--;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_report
+//
+//  Arguments:      name:     The name of the pool
+//                  pool:     The pool
+//
+//  Returns:        void
+//
+//  Description:    This function writes the object size of the pool, and
+//                  the number of objects used now and at most, to the
+//                  console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pool_report(char *name, struct pool *pool)
+{
+    uart_puts("    ");
+    uart_puts(name);
+    uart_puts(" object size:  0x");
+    uart_puthex(pool->size);
+    uart_puts(", used:  0x");
+    uart_puthex(pool->used);
+    uart_puts(", most used:  0x");
+    uart_puthex(pool->high);
+    uart_puts("\n");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heap_init
+//
+//  Arguments:      end:     The end of the ARM memory
+//
+//  Returns:        void
+//
+//  Description:    This function gives all the RAM from the end of the
+//                  kernel image to the end of the ARM memory to the heap
+//                  arena, and takes the frame arena from the bottom of it.
+//                  It must be called once, before heap_alloc().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void heap_init(unsigned long end)
+{
+    unsigned long start = ((unsigned long)_end + HEAP_ALIGN - 1) & ~(unsigned long)(HEAP_ALIGN - 1);
+    void *frame;
+    unsigned int i;
+
+    if (end < start) {
+        end = start;
+    }
+    arena_init(&heapArena, (void *)start, end - start);
+
+    frame = arena_alloc(&heapArena, HEAP_FRAME_SIZE, HEAP_ALIGN);
+    arena_init(&heapFrameArena, frame, frame ? HEAP_FRAME_SIZE : 0);
+
+    for (i = 0; i < HEAP_CLASSES; i++) {
+        heapFree[i] = 0;
+        heapFreeCount[i] = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heap_alloc
+//
+//  Arguments:      size:     The number of bytes needed
+//
+//  Returns:        A pointer to memory aligned on HEAP_ALIGN bytes, or 0 if
+//                  there is not enough free memory.
+//
+//  Description:    This function finds the smallest power of 2 that holds
+//                  the memory and its header, and takes a block of that
+//                  size from its free list, or else from the heap arena.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *heap_alloc(unsigned long size)
+{
+    unsigned long need = size + HEAP_ALIGN;
+    unsigned long shift = HEAP_MIN_SHIFT;
+    struct heap_block *block;
+
+    if (need > (1UL << HEAP_MIN_SHIFT)) {
+        shift = 64 - __builtin_clzl(need - 1);
+    }
+
+    if ((size > (1UL << HEAP_MAX_SHIFT)) || (shift > HEAP_MAX_SHIFT)) {
+        heapFailures++;
+        return 0;
+    }
+
+    block = heapFree[shift - HEAP_MIN_SHIFT];
+    if (block) {
+        heapFree[shift - HEAP_MIN_SHIFT] = block->next;
+        heapFreeCount[shift - HEAP_MIN_SHIFT]--;
+        block->shift = shift;
+    } else {
+        block = arena_alloc(&heapArena, 1UL << shift, HEAP_ALIGN);
+        if (block == 0) {
+            heapFailures++;
+            return 0;
+        }
+        block->shift = shift;
+    }
+
+    heapAllocs++;
+    heapInUse += 1UL << shift;
+    if (heapInUse > heapInUseHigh) {
+        heapInUseHigh = heapInUse;
+    }
+
+    return (char *)block + HEAP_ALIGN;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heap_free
+//
+//  Arguments:      pointer:     Memory from heap_alloc(), or 0
+//
+//  Returns:        void
+//
+//  Description:    This function puts the block back on the free list of its
+//                  size, read from the header in front of it. A pointer
+//                  that is not in the heap arena, or whose header is not
+//                  that of a block in use (such as a block already freed),
+//                  is not freed, and is counted.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void heap_free(void *pointer)
+{
+    unsigned long address = (unsigned long)pointer;
+    struct heap_block *block;
+    unsigned long shift;
+
+    if (pointer == 0) {
+        return;
+    }
+
+    if ((address & (HEAP_ALIGN - 1)) ||
+        (address < heapArena.start + HEAP_ALIGN) || (address >= heapArena.top)) {
+        heapBadFrees++;
+        return;
+    }
+
+    block = (struct heap_block *)(address - HEAP_ALIGN);
+    shift = block->shift;
+    if ((shift < HEAP_MIN_SHIFT) || (shift > HEAP_MAX_SHIFT) ||
+        ((1UL << shift) > heapArena.top - (unsigned long)block)) {
+        heapBadFrees++;
+        return;
+    }
+
+    block->shift = shift | HEAP_BLOCK_FREE;
+    block->next = heapFree[shift - HEAP_MIN_SHIFT];
+    heapFree[shift - HEAP_MIN_SHIFT] = block;
+    heapFreeCount[shift - HEAP_MIN_SHIFT]++;
+
+    heapFrees++;
+    heapInUse -= 1UL << shift;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heap_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the bounds of the heap, the use of
+//                  the heap arena and the frame arena, the heap_alloc() and
+//                  heap_free() statistics, and the number of free blocks
+//                  of each size that has any, to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void heap_report()
+{
+    unsigned int i;
+
+    uart_puts("\nHeap report:\n");
+    uart_puts("    start:  0x");
+    uart_puthex(heapArena.start);
+    uart_puts(", end:  0x");
+    uart_puthex(heapArena.end);
+    uart_puts("\n");
+    arena_report("heap arena", &heapArena);
+    arena_report("frame arena", &heapFrameArena);
+    uart_puts("    allocations:  0x");
+    uart_puthex(heapAllocs);
+    uart_puts(", frees:  0x");
+    uart_puthex(heapFrees);
+    uart_puts(", failures:  0x");
+    uart_puthex(heapFailures);
+    uart_puts(", bad frees:  0x");
+    uart_puthex(heapBadFrees);
+    uart_puts("\n");
+    uart_puts("    bytes in use:  0x");
+    uart_puthex(heapInUse);
+    uart_puts(", most in use:  0x");
+    uart_puthex(heapInUseHigh);
+    uart_puts("\n");
+
+    for (i = 0; i < HEAP_CLASSES; i++) {
+        if (heapFreeCount[i]) {
+            uart_puts("    free blocks of 2^0x");
+            uart_puthex(i + HEAP_MIN_SHIFT);
+            uart_puts(" bytes:  0x");
+            uart_puthex(heapFreeCount[i]);
+            uart_puts("\n");
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+// Definitions and function prototypes for the memory manager in heap.c
+
+// End of the ARM memory of a Raspberry Pi 3 with the default 76 MB of GPU
+// memory, used if the firmware cannot be asked for it
+#define HEAP_DEFAULT_END        0x3B400000
+
+// Alignment of the blocks given out by heap_alloc(), and the size of the
+// header in front of each block
+#define HEAP_ALIGN              16
+
+// Sizes of the smallest and largest blocks of heap_alloc(), as powers of 2
+// (32 bytes to 1 GB, including the header)
+#define HEAP_MIN_SHIFT          5
+#define HEAP_MAX_SHIFT          30
+#define HEAP_CLASSES            (HEAP_MAX_SHIFT - HEAP_MIN_SHIFT + 1)
+
+// Size of the frame arena, the scratch memory of one pass of a main loop
+#define HEAP_FRAME_SIZE         0x100000
+
+// A bump arena. Memory is given out from the top up, and is only taken back
+// all at once, by resetting the arena to a mark (for example at the end of
+// every frame).
+struct arena {
+    unsigned long start;
+    unsigned long top;
+    unsigned long end;
+    unsigned long high;
+};
+
+// A pool of objects of one size. Freed objects are kept on a list, and the
+// memory that has never been used is given out from the bottom up, so the
+// pool needs no setup beyond pool_init().
+struct pool {
+    void *free;
+    unsigned long next;
+    unsigned long end;
+    unsigned long size;
+    unsigned int used;
+    unsigned int high;
+};
+
+// The frame arena, taken from the heap arena by heap_init(). A main loop
+// resets it to a mark on every pass, so what it gives out only lives until
+// the next pass.
+extern struct arena heapFrameArena;
+
+// Function prototypes
+void arena_init(struct arena *arena, void *memory, unsigned long size);
+void *arena_alloc(struct arena *arena, unsigned long size, unsigned long align);
+unsigned long arena_mark(struct arena *arena);
+void arena_reset(struct arena *arena, unsigned long mark);
+void arena_report(char *name, struct arena *arena);
+
+void pool_init(struct pool *pool, void *memory, unsigned long size, unsigned int count);
+void *pool_alloc(struct pool *pool);
+void pool_free(struct pool *pool, void *object);
+void pool_report(char *name, struct pool *pool);
+
+void heap_init(unsigned long end);
+void *heap_alloc(unsigned long size);
+void heap_free(void *pointer);
+void heap_report();
+
+#endif
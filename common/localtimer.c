@@ -0,0 +1,325 @@
+// The functions in this file drive the generic timer of each core, so that
+// every core can keep its own deadlines. The System Timer in systimer.c is
+// shared by all the cores, and its interrupts are only routed to core 0.
+//
+// Every Cortex-A53 core has its own non-secure physical timer (CNTP). It
+// compares the system counter (CNTPCT_EL0), which runs at the same rate on
+// all the cores, with the core's compare value register (CNTP_CVAL_EL0),
+// and raises an interrupt while the counter has reached it. The timer
+// control register of each core, in the ARM local peripherals, routes that
+// interrupt to the same core's IRQ. The start routines let EL1 use the
+// physical timer (see CNTHCTL_EL2).
+//
+// A timer either fires once, at a deadline set with local_timer_set() or
+// local_timer_after(), or periodically, after local_timer_start(). The
+// IRQ handler of every kernel calls local_timer_irq(), which sets the next
+// deadline of a periodic timer, or turns off a one-shot timer, and calls
+// the function of the timer. Each core only changes its own timer, and its
+// own entry of the timer table, so no locks are needed.
+
+// Header files
+#include "uart.h"
+#include "smp.h"
+#include "localtimer.h"
+
+// The timer of each core: the function called when it fires, its deadline
+// and period in counter ticks (0 for a one-shot timer), the largest delay
+// seen between the deadline and the IRQ handler, and the number of times it
+// has fired. Each entry is on its own cache line.
+struct local_timer {
+    local_timer_fn_t fn;
+    unsigned long deadline;
+    unsigned long period;
+    unsigned long lateMax;
+    unsigned int fired;
+} __attribute__((aligned(64)));
+
+// Local timer global variables
+struct local_timer localTimers[SMP_CORES];
+unsigned long localTimerFrequency = LOCAL_TIMER_DEFAULT_FREQUENCY;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_arm
+//
+//  Arguments:      timer:       The timer of this core
+//                  deadline:    The counter value at which it fires
+//
+//  Returns:        void
+//
+//  Description:    This function sets the compare value of this core's
+//                  physical timer, and enables it with its interrupt
+//                  unmasked. A deadline already passed fires at once.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void local_timer_arm(struct local_timer *timer, unsigned long deadline)
+{
+    timer->deadline = deadline;
+    asm volatile("msr cntp_cval_el0, %0" : : "r" (deadline));
+    asm volatile("msr cntp_ctl_el0, %0\n"
+                 "isb" : : "r" ((unsigned long)CNTP_CTL_ENABLE));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function turns off the timer of this core, and
+//                  routes its interrupt to this core's IRQ. It must be
+//                  called by each core that uses its timer. The counter
+//                  frequency is read from CNTFRQ_EL0, which the firmware
+//                  sets.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_init()
+{
+    unsigned int core = smp_core();
+    unsigned long frequency;
+
+    asm volatile("msr cntp_ctl_el0, xzr\n"
+                 "isb");
+    localTimers[core].fn = 0;
+    localTimers[core].period = 0;
+
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (frequency));
+    if (frequency) {
+        localTimerFrequency = frequency;
+    }
+
+    *CORE_TIMER_CONTROL(core) = CORE_TIMER_CNTPNS;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_now
+//
+//  Arguments:      none
+//
+//  Returns:        The value of the system counter, in ticks.
+//
+//  Description:    The isb makes sure the counter is not read before the
+//                  instructions before it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long local_timer_now()
+{
+    unsigned long ticks;
+
+    asm volatile("isb\n"
+                 "mrs %0, cntpct_el0" : "=r" (ticks));
+    return ticks;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_ticks
+//
+//  Arguments:      microseconds:     A time
+//
+//  Returns:        The number of counter ticks in the time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long local_timer_ticks(unsigned int microseconds)
+{
+    return (unsigned long)microseconds * localTimerFrequency / 1000000;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_set
+//
+//  Arguments:      deadline:     The counter value at which the timer fires
+//                  fn:           The function to call, or 0
+//
+//  Returns:        void
+//
+//  Description:    This function sets a one-shot deadline for the timer of
+//                  this core, replacing any deadline set before.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_set(unsigned long deadline, local_timer_fn_t fn)
+{
+    struct local_timer *timer = &localTimers[smp_core()];
+
+    timer->fn = fn;
+    timer->period = 0;
+    local_timer_arm(timer, deadline);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_after
+//
+//  Arguments:      microseconds:     The time from now to the deadline
+//                  fn:               The function to call, or 0
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_after(unsigned int microseconds, local_timer_fn_t fn)
+{
+    local_timer_set(local_timer_now() + local_timer_ticks(microseconds), fn);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_start
+//
+//  Arguments:      period:     The time between ticks, in microseconds
+//                  fn:         The function to call on every tick, or 0
+//
+//  Returns:        void
+//
+//  Description:    This function makes the timer of this core fire
+//                  periodically. Each deadline is one period after the
+//                  last one, so the ticks do not drift.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_start(unsigned int period, local_timer_fn_t fn)
+{
+    struct local_timer *timer = &localTimers[smp_core()];
+
+    timer->fn = fn;
+    timer->period = local_timer_ticks(period);
+    if (timer->period == 0) {
+        timer->period = 1;
+    }
+    local_timer_arm(timer, local_timer_now() + timer->period);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_cancel
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function turns off the timer of this core.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_cancel()
+{
+    struct local_timer *timer = &localTimers[smp_core()];
+
+    asm volatile("msr cntp_ctl_el0, xzr\n"
+                 "isb");
+    timer->fn = 0;
+    timer->period = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_irq
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the timer of this core had fired.
+//
+//  Description:    This function is called by the IRQ handler of every
+//                  core. A periodic timer is given its next deadline (or,
+//                  if whole periods were missed, one period from now), and
+//                  a one-shot timer is turned off, which clears the
+//                  interrupt. The function of the timer is then called.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int local_timer_irq()
+{
+    unsigned int core = smp_core();
+    struct local_timer *timer = &localTimers[core];
+    unsigned long now, late, next;
+
+    if (!(*CORE_IRQ_SOURCE(core) & CORE_TIMER_CNTPNS)) {
+        return 0;
+    }
+
+    now = local_timer_now();
+    late = now - timer->deadline;
+    if (late > timer->lateMax) {
+        timer->lateMax = late;
+    }
+    timer->fired++;
+
+    if (timer->period) {
+        next = timer->deadline + timer->period;
+        if (next <= now) {
+            next = now + timer->period;
+        }
+        local_timer_arm(timer, next);
+    } else {
+        asm volatile("msr cntp_ctl_el0, xzr\n"
+                     "isb");
+    }
+
+    if (timer->fn) {
+        timer->fn(core);
+    }
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       local_timer_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the counter frequency, and the
+//                  number of times the timer of each core has fired and its
+//                  largest delay (in counter ticks), to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void local_timer_report()
+{
+    unsigned int core;
+
+    uart_puts("\nLocal timer report:\n");
+    uart_puts("    frequency:  0x");
+    uart_puthex(localTimerFrequency);
+    uart_puts("\n");
+    for (core = 0; core < SMP_CORES; core++) {
+        uart_puts("    core ");
+        uart_putc('0' + core);
+        uart_puts(" fired:  0x");
+        uart_puthex(localTimers[core].fired);
+        uart_puts(", most ticks late:  0x");
+        uart_puthex(localTimers[core].lateMax);
+        uart_puts("\n");
+    }
+}
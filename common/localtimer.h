@@ -0,0 +1,42 @@
+#ifndef LOCALTIMER_H
+#define LOCALTIMER_H
+
+// Definitions and function prototypes for the per-core timers in
+// localtimer.c
+
+// Header files
+#include "smp.h"
+
+// The timer interrupt control register of each core, in the ARM local
+// peripherals. Setting a bit routes one of the core's generic timer
+// interrupts to the core's IRQ.
+#define CORE_TIMER_CONTROL(core)        ((volatile unsigned int *)(ARM_LOCAL_BASE + 0x40 + 4 * (core)))
+
+// Bit of the timer interrupt control register, and of the core IRQ source
+// register, for the non-secure physical timer (CNTP)
+#define CORE_TIMER_CNTPNS       (0x1 << 1)
+
+// Bits of the physical timer control register (CNTP_CTL_EL0)
+#define CNTP_CTL_ENABLE         (0x1 << 0)
+#define CNTP_CTL_IMASK          (0x1 << 1)
+
+// Counter frequency used if the firmware has not set CNTFRQ_EL0 (19.2 MHz,
+// the crystal of the Raspberry Pi 3)
+#define LOCAL_TIMER_DEFAULT_FREQUENCY   19200000
+
+// A function called by the IRQ handler when the timer of a core expires.
+// It runs on that core, and may set the next deadline.
+typedef void (*local_timer_fn_t)(unsigned int core);
+
+// Function prototypes
+void local_timer_init();
+unsigned long local_timer_now();
+unsigned long local_timer_ticks(unsigned int microseconds);
+void local_timer_set(unsigned long deadline, local_timer_fn_t fn);
+void local_timer_after(unsigned int microseconds, local_timer_fn_t fn);
+void local_timer_start(unsigned int period, local_timer_fn_t fn);
+void local_timer_cancel();
+int local_timer_irq();
+void local_timer_report();
+
+#endif
@@ -0,0 +1,193 @@
+// The functions in this file turn on the MMU and the caches, with every
+// address mapped to itself (an identity map). With the MMU off, every data
+// access is treated as a device access: it is not cached, and the
+// exclusive load and store instructions used by the atomics in atomic.h
+// cannot work, since the BCM2837 has no global exclusive monitor for
+// uncached memory. The identity map makes the RAM used by the program
+// normal, cacheable, inner shareable memory, so the caches of the four
+// cores are kept coherent and the atomics work between cores.
+//
+// The map is made of 2 MB blocks, with a level 1 table covering 4 GB and
+// two level 2 tables covering the first 2 GB:
+//
+//   - RAM below cachedEnd is cacheable (write-back).
+//   - RAM from cachedEnd to the peripherals is not cacheable. This is
+//     where the GPU keeps the frame buffer, which it reads without looking
+//     at the ARM caches.
+//   - The peripherals at 0x3F000000, and the ARM local peripherals at
+//     0x40000000, are device memory, and are never executed.
+//
+// Core 0 builds the tables with mmu_init(), and the other cores use the
+// same tables when they call mmu_enable().
+
+// Header files
+#include "mmu.h"
+
+// Memory attributes, by their index in MAIR_EL1
+#define MMU_ATTR_DEVICE         0       // Device-nGnRnE
+#define MMU_ATTR_NORMAL         1       // Normal, write-back, allocate
+#define MMU_ATTR_UNCACHED       2       // Normal, not cacheable
+#define MMU_MAIR                ((0x00UL << (8 * MMU_ATTR_DEVICE)) | \
+                                 (0xFFUL << (8 * MMU_ATTR_NORMAL)) | \
+                                 (0x44UL << (8 * MMU_ATTR_UNCACHED)))
+
+// Fields of a table or block descriptor
+#define MMU_TABLE               0x3
+#define MMU_BLOCK               0x1
+#define MMU_ATTR_INDEX(i)       ((unsigned long)(i) << 2)
+#define MMU_INNER_SHAREABLE     (0x3UL << 8)
+#define MMU_ACCESS_FLAG         (0x1UL << 10)
+#define MMU_NEVER_EXECUTE       ((0x1UL << 53) | (0x1UL << 54))
+
+// Translation Control Register: a 4 GB address space (T0SZ = 32) walked
+// from TTBR0_EL1 with 4 KB granules, through cacheable inner shareable
+// memory. Walks through TTBR1_EL1 are disabled (EPD1).
+#define MMU_TCR                 (32UL | (0x1UL << 8) | (0x1UL << 10) | \
+                                 (0x3UL << 12) | (0x1UL << 23))
+
+// Bits of the System Control Register: the MMU, the data cache, and the
+// instruction cache
+#define MMU_SCTLR_M             (0x1UL << 0)
+#define MMU_SCTLR_C             (0x1UL << 2)
+#define MMU_SCTLR_I             (0x1UL << 12)
+
+// Translation tables
+unsigned long mmuLevel1[512] __attribute__((aligned(4096)));
+unsigned long mmuLevel2[2][512] __attribute__((aligned(4096)));
+volatile int mmuReady;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmu_init
+//
+//  Arguments:      cachedEnd:     The end of the RAM to cache (rounded down
+//                                 to 2 MB). RAM above it, up to the
+//                                 peripherals, is not cached.
+//
+//  Returns:        void
+//
+//  Description:    This function builds the translation tables, and turns
+//                  on the MMU and the caches of this core. It must be called
+//                  once, by core 0, before the other cores are started.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mmu_init(unsigned long cachedEnd)
+{
+    unsigned long address, attributes;
+    unsigned int i;
+
+    for (i = 0; i < 512; i++) {
+        mmuLevel1[i] = 0;
+        mmuLevel2[1][i] = 0;
+    }
+    mmuLevel1[0] = (unsigned long)mmuLevel2[0] | MMU_TABLE;
+    mmuLevel1[1] = (unsigned long)mmuLevel2[1] | MMU_TABLE;
+
+    // The first 1 GB: RAM, then the peripherals
+    for (i = 0; i < 512; i++) {
+        address = (unsigned long)i * MMU_BLOCK_SIZE;
+        if (address >= MMU_PERIPHERAL_BASE) {
+            attributes = MMU_ATTR_INDEX(MMU_ATTR_DEVICE) | MMU_NEVER_EXECUTE;
+        } else if (address + MMU_BLOCK_SIZE <= cachedEnd) {
+            attributes = MMU_ATTR_INDEX(MMU_ATTR_NORMAL) | MMU_INNER_SHAREABLE;
+        } else {
+            attributes = MMU_ATTR_INDEX(MMU_ATTR_UNCACHED) | MMU_INNER_SHAREABLE;
+        }
+        mmuLevel2[0][i] = address | attributes | MMU_ACCESS_FLAG | MMU_BLOCK;
+    }
+
+    // The ARM local peripherals, in the first block of the second 1 GB
+    mmuLevel2[1][0] = MMU_LOCAL_BASE | MMU_ATTR_INDEX(MMU_ATTR_DEVICE) |
+                      MMU_NEVER_EXECUTE | MMU_ACCESS_FLAG | MMU_BLOCK;
+
+    mmu_enable();
+
+    // The other cores read this flag with their caches still off
+    mmuReady = 1;
+    mmu_clean(&mmuReady, sizeof(mmuReady));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmu_enable
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function turns on the MMU and the caches of this
+//                  core, using the tables built by mmu_init().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mmu_enable()
+{
+    unsigned long sctlr;
+
+    asm volatile("tlbi vmalle1\n"
+                 "dsb ish\n"
+                 "isb" : : : "memory");
+
+    asm volatile("msr mair_el1, %0" : : "r" (MMU_MAIR));
+    asm volatile("msr tcr_el1, %0" : : "r" (MMU_TCR));
+    asm volatile("msr ttbr0_el1, %0" : : "r" ((unsigned long)mmuLevel1));
+    asm volatile("isb");
+
+    asm volatile("mrs %0, sctlr_el1" : "=r" (sctlr));
+    sctlr |= MMU_SCTLR_M | MMU_SCTLR_C | MMU_SCTLR_I;
+    asm volatile("msr sctlr_el1, %0\n"
+                 "isb" : : "r" (sctlr) : "memory");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmu_enabled
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if core 0 has turned on the MMU.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int mmu_enabled()
+{
+    return mmuReady;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmu_clean
+//
+//  Arguments:      start:     The first address
+//                  size:      The number of bytes
+//
+//  Returns:        void
+//
+//  Description:    This function writes the cached data of a range of memory
+//                  back to RAM, and removes it from the caches, so that a
+//                  reader that does not look at the caches (the GPU, or a
+//                  core with its caches still off) sees the same data as
+//                  the cores. It is harmless if the caches are off.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mmu_clean(const volatile void *start, unsigned long size)
+{
+    unsigned long line = (unsigned long)start & ~(unsigned long)(MMU_CACHE_LINE - 1);
+    unsigned long end = (unsigned long)start + size;
+
+    asm volatile("dsb sy" : : : "memory");
+    for (; line < end; line += MMU_CACHE_LINE) {
+        asm volatile("dc civac, %0" : : "r" (line) : "memory");
+    }
+    asm volatile("dsb sy" : : : "memory");
+}
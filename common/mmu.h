@@ -0,0 +1,24 @@
+#ifndef MMU_H
+#define MMU_H
+
+// Definitions and function prototypes for the identity-mapped MMU setup in
+// mmu.c
+
+// Size of a data cache line of the Cortex-A53, in bytes
+#define MMU_CACHE_LINE          64
+
+// Size of the blocks the memory is mapped with (2 MB)
+#define MMU_BLOCK_SIZE          0x200000
+
+// Start of the peripherals, and of the ARM local peripherals. Both are
+// mapped as device memory.
+#define MMU_PERIPHERAL_BASE     0x3F000000
+#define MMU_LOCAL_BASE          0x40000000
+
+// Function prototypes
+void mmu_init(unsigned long cachedEnd);
+void mmu_enable();
+int mmu_enabled();
+void mmu_clean(const volatile void *start, unsigned long size);
+
+#endif
@@ -0,0 +1,65 @@
+// This routine is where a secondary core (1 to 3) starts running the
+// program, once smp_start() in smp.c has written its address to the core's
+// spin table slot. It sets up the core the same way the start routine
+// sets up core 0: the core changes from EL2 to EL1, with its own stacks
+// and the exception vectors in vectors.s. It then calls
+// smp_secondary_main(), which never returns.
+
+
+	.text
+
+	.global	_secondary_start
+_secondary_start:
+	// Keep the core number in x19, which is not changed by the
+	// exception return below
+	mrs	x19, mpidr_el1
+	and	x19, x19, 0x3
+
+	// Load the stack pointers chosen by smp_start(). The program runs on
+	// the EL0 SP (kept in x20 until we are at EL1), and the exception
+	// handlers on the EL1 SP.
+	adrp	x0, smpStack
+	add	x0, x0, :lo12:smpStack
+	ldr	x20, [x0, x19, lsl 3]
+	adrp	x0, smpExceptionStack
+	add	x0, x0, :lo12:smpExceptionStack
+	ldr	x0, [x0, x19, lsl 3]
+	msr	sp_el1, x0
+
+	// Run EL1 in AArch64, with IRQ, FIQ, and SError exceptions handled
+	// at EL1 (see the start routine)
+	mov	x0, (1 << 31)		// Enable AArch64
+	orr	x0, x0, (1 << 1)	// SWIO is hardwired on the Pi3
+	msr	hcr_el2, x0
+
+	// Give EL1 access to all of the PMU event counters
+	mrs	x0, pmcr_el0
+	ubfx	x0, x0, 11, 5
+	msr	mdcr_el2, x0
+
+	// Let EL1 use the physical counter and timer
+	mov	x0, 0x3
+	msr	cnthctl_el2, x0
+	msr	cntvoff_el2, xzr
+
+	// Use the same exception vectors as core 0
+	adrp	x0, _vectors
+	add	x0, x0, :lo12:_vectors
+	msr	vbar_el1, x0
+
+	// Change to EL1 with all exceptions masked, using SP_EL0
+	mov	x0, 0x3C4
+	msr	spsr_el2, x0
+	adr	x0, secondary_el1
+	msr	elr_el2, x0
+	eret
+
+secondary_el1:
+	mov	sp, x20
+	mov	x0, x19
+	bl	smp_secondary_main
+
+	// smp_secondary_main() never returns, but if it does, stop the core
+secondary_hang:
+	wfe
+	b	secondary_hang
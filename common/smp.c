@@ -0,0 +1,363 @@
+// The functions in this file start the three secondary cores of the
+// Cortex-A53, and let the cores ask each other to run functions.
+//
+// When the program starts, only core 0 runs it. The other cores wait in a
+// loop (in the firmware, or in the start routine), reading their slot of
+// the spin table. smp_start() gives the core its own stacks, writes the
+// address of _secondary_start (in secondary.s) to the slot, and wakes it
+// with sev. The core then changes from EL2 to EL1 the same way as core 0,
+// and calls smp_secondary_main(), which runs the entry function and then
+// waits for calls from the other cores.
+//
+// smp_call() runs a function on another core through its ARM local
+// mailbox 0: the caller fills in its call slot for that core, and sets the
+// bit of mailbox 0 numbered after itself, which raises an IRQ on the other
+// core. The IRQ handler of every kernel calls smp_ipi(), which runs the
+// function and frees the slot. Each slot has only one writer (the calling
+// core) until it is handed over, and the mailbox bits are set and cleared
+// by the hardware, so no locks are needed.
+
+// Header files
+#include "uart.h"
+#include "mmu.h"
+#include "smp.h"
+
+// A call slot: the function to run, or 0 if the slot is free
+struct smp_call {
+    volatile smp_fn_t fn;
+    volatile unsigned long arg;
+};
+
+// Stacks of the secondary cores (core 0 uses the stacks set up by the
+// start routine), and the initial stack pointers read by secondary.s
+unsigned char smpStackMemory[SMP_CORES][SMP_STACK_SIZE] __attribute__((aligned(16)));
+unsigned char smpExceptionStackMemory[SMP_CORES][SMP_EXCEPTION_STACK_SIZE] __attribute__((aligned(16)));
+unsigned long smpStack[SMP_CORES];
+unsigned long smpExceptionStack[SMP_CORES];
+
+// The entry function of each secondary core, and whether it is running
+smp_fn_t smpEntry[SMP_CORES];
+unsigned long smpEntryArg[SMP_CORES];
+volatile unsigned int smpRunning[SMP_CORES];
+
+// The call slots of each core, by the number of the calling core, and the
+// number of calls each core has run
+struct smp_call smpCalls[SMP_CORES][SMP_CORES];
+volatile unsigned int smpCallsRun[SMP_CORES];
+
+// The first instruction run by a secondary core, in secondary.s
+extern char _secondary_start[];
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_core
+//
+//  Arguments:      none
+//
+//  Returns:        The number of the core running this code (0 to 3).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int smp_core()
+{
+    unsigned long mpidr;
+
+    asm volatile("mrs %0, mpidr_el1" : "=r" (mpidr));
+    return mpidr & 0x3;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_start
+//
+//  Arguments:      core:      The secondary core to start (1 to 3)
+//                  entry:     The function it runs first, or 0
+//                  arg:       The argument passed to the function
+//
+//  Returns:        0 if the core is running, or -1 if the core number is not
+//                  valid, the core was already started, or it did not start.
+//
+//  Description:    This function releases a secondary core from the spin
+//                  table. Once the entry function returns, the core waits
+//                  for calls from smp_call(). Mailbox 0 of the calling core
+//                  is also enabled, so that the new core can call it back.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int smp_start(unsigned int core, smp_fn_t entry, unsigned long arg)
+{
+    volatile unsigned long *slot;
+    unsigned int wait;
+
+    if ((core == 0) || (core >= SMP_CORES) || smpRunning[core]) {
+        return -1;
+    }
+
+    smpStack[core] = (unsigned long)&smpStackMemory[core][SMP_STACK_SIZE];
+    smpExceptionStack[core] =
+        (unsigned long)&smpExceptionStackMemory[core][SMP_EXCEPTION_STACK_SIZE];
+    smpEntry[core] = entry;
+    smpEntryArg[core] = arg;
+
+    *CORE_MAILBOX_CONTROL(smp_core()) = 0x1;
+
+    // Make sure the stacks and entry function are written before the core
+    // is released. They and the slot are cleaned to memory, since the
+    // waiting core reads them with its data cache off, until it turns on
+    // the MMU.
+    mmu_clean(smpStackMemory[core], SMP_STACK_SIZE);
+    mmu_clean(smpExceptionStackMemory[core], SMP_EXCEPTION_STACK_SIZE);
+    mmu_clean(smpStack, sizeof(smpStack));
+    mmu_clean(smpExceptionStack, sizeof(smpExceptionStack));
+    mmu_clean(smpEntry, sizeof(smpEntry));
+    mmu_clean(smpEntryArg, sizeof(smpEntryArg));
+
+    slot = &SMP_SPIN_TABLE[core];
+    asm volatile("dsb sy" : : : "memory");
+    *slot = (unsigned long)_secondary_start;
+    asm volatile("dc civac, %0" : : "r" (slot) : "memory");
+    asm volatile("dsb sy\n"
+                 "sev" : : : "memory");
+
+    for (wait = 0; wait < 10000000; wait++) {
+        if (smpRunning[core]) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_running
+//
+//  Arguments:      core:     The core number
+//
+//  Returns:        TRUE (non-zero) if the core is running the program.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int smp_running(unsigned int core)
+{
+    return (core == 0) || ((core < SMP_CORES) && smpRunning[core]);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_secondary_main
+//
+//  Arguments:      core:     The number of this core
+//
+//  Returns:        never
+//
+//  Description:    This function is called by _secondary_start in
+//                  secondary.s, once the core runs at EL1 on its own
+//                  stacks. The MMU is turned on if core 0 turned it on, so
+//                  that this core's caches are coherent with the others.
+//                  Mailbox 0 and IRQs are enabled, so other cores can call
+//                  this one, and the entry function is run. The core then
+//                  sleeps until an interrupt arrives.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void smp_secondary_main(unsigned int core)
+{
+    if (mmu_enabled()) {
+        mmu_enable();
+    }
+
+    *CORE_MAILBOX_CONTROL(core) = 0x1;
+    asm volatile("msr DAIFClr, 0b0010");
+
+    smpRunning[core] = 1;
+
+    if (smpEntry[core]) {
+        smpEntry[core](smpEntryArg[core]);
+    }
+
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_call
+//
+//  Arguments:      core:     The core to run the function on
+//                  fn:       The function
+//                  arg:      The argument passed to the function
+//
+//  Returns:        0 if the call was sent, or -1 if the core is this core,
+//                  or is not running.
+//
+//  Description:    This function asks another core to run a function from
+//                  its IRQ handler, and returns without waiting for it (see
+//                  smp_wait()). If the last call from this core to the
+//                  other core has not been run yet, this function waits for
+//                  it first. It must not be called from an IRQ handler, since
+//                  two cores calling each other would then wait forever.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int smp_call(unsigned int core, smp_fn_t fn, unsigned long arg)
+{
+    unsigned int self = smp_core();
+    struct smp_call *call;
+
+    if ((core == self) || !smp_running(core)) {
+        return -1;
+    }
+
+    call = &smpCalls[core][self];
+    while (call->fn) {
+        ;
+    }
+
+    // Make sure the argument is written before the function, and the
+    // function before the mailbox is set
+    call->arg = arg;
+    asm volatile("dmb sy" : : : "memory");
+    call->fn = fn;
+    asm volatile("dsb sy" : : : "memory");
+    *CORE_MAILBOX_SET(core, 0) = 0x1 << self;
+
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_wait
+//
+//  Arguments:      core:     The core that was called
+//
+//  Returns:        void
+//
+//  Description:    This function waits until the last function sent to a
+//                  core with smp_call() from this core has been run.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void smp_wait(unsigned int core)
+{
+    if (core >= SMP_CORES) {
+        return;
+    }
+
+    while (smpCalls[core][smp_core()].fn) {
+        ;
+    }
+    asm volatile("dmb sy" : : : "memory");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_ipi
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function is called by the IRQ handler of every core.
+//                  If mailbox 0 of this core has bits set, they are cleared,
+//                  and the function in the call slot of each calling core
+//                  is run, lowest core first. The slot is freed once the
+//                  function returns.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void smp_ipi()
+{
+    unsigned int core = smp_core();
+    unsigned int pending, source;
+    struct smp_call *call;
+
+    if (!(*CORE_IRQ_SOURCE(core) & CORE_IRQ_MAILBOX_0)) {
+        return;
+    }
+
+    pending = *CORE_MAILBOX_CLEAR(core, 0);
+    *CORE_MAILBOX_CLEAR(core, 0) = pending;
+    asm volatile("dmb sy" : : : "memory");
+
+    while (pending) {
+        source = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        call = &smpCalls[core][source & (SMP_CORES - 1)];
+        if (call->fn) {
+            call->fn(call->arg);
+            smpCallsRun[core]++;
+
+            // Make sure the function's writes are seen before the slot
+            // is freed
+            asm volatile("dmb sy" : : : "memory");
+            call->fn = 0;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_ping
+//
+//  Arguments:      arg:     Not used
+//
+//  Returns:        void
+//
+//  Description:    This function does nothing. It is sent with smp_call() to
+//                  check that a core answers calls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void smp_ping(unsigned long arg)
+{
+    return;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       smp_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes whether each core is running, and
+//                  the number of calls it has run, to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void smp_report()
+{
+    unsigned int core;
+
+    uart_puts("\nSMP report:\n");
+    for (core = 0; core < SMP_CORES; core++) {
+        uart_puts("    core ");
+        uart_putc('0' + core);
+        uart_puts(smp_running(core) ? " running, calls run:  0x" :
+                                      " stopped, calls run:  0x");
+        uart_puthex(smpCallsRun[core]);
+        uart_puts("\n");
+    }
+}
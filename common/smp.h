@@ -0,0 +1,49 @@
+#ifndef SMP_H
+#define SMP_H
+
+// Definitions and function prototypes for the multi-core support in smp.c
+// and secondary.s
+
+// Number of CPU cores of the Cortex-A53
+#define SMP_CORES               4
+
+// Size of the program stack and of the exception stack of each secondary
+// core, in bytes
+#define SMP_STACK_SIZE          0x10000
+#define SMP_EXCEPTION_STACK_SIZE 0x4000
+
+// The spin table: the firmware (or the start routine) makes each secondary
+// core wait until an entry address is written to its 64-bit slot, at
+// 0xE0 for core 1, 0xE8 for core 2, and 0xF0 for core 3
+#define SMP_SPIN_TABLE          ((volatile unsigned long *)0xD8)
+
+// The addresses of the ARM local peripherals of the BCM2837 (see the QA7
+// ARM Quad A7 core document). Each core has 4 mailboxes. Writing a 1 bit to
+// a mailbox set register sets that bit of the mailbox, and writing a 1 bit
+// to a mailbox clear register clears it. The core gets an IRQ while one of
+// its mailboxes is not zero, if the mailbox is enabled in the core's
+// mailbox interrupt control register.
+#define ARM_LOCAL_BASE          0x40000000UL
+
+#define CORE_MAILBOX_CONTROL(core)      ((volatile unsigned int *)(ARM_LOCAL_BASE + 0x50 + 4 * (core)))
+#define CORE_IRQ_SOURCE(core)           ((volatile unsigned int *)(ARM_LOCAL_BASE + 0x60 + 4 * (core)))
+#define CORE_MAILBOX_SET(core, box)     ((volatile unsigned int *)(ARM_LOCAL_BASE + 0x80 + 16 * (core) + 4 * (box)))
+#define CORE_MAILBOX_CLEAR(core, box)   ((volatile unsigned int *)(ARM_LOCAL_BASE + 0xC0 + 16 * (core) + 4 * (box)))
+
+// Bit of the core IRQ source register set while mailbox 0 is not zero
+#define CORE_IRQ_MAILBOX_0      (0x1 << 4)
+
+// A function run on another core, and the argument passed to it
+typedef void (*smp_fn_t)(unsigned long arg);
+
+// Function prototypes
+unsigned int smp_core();
+int smp_start(unsigned int core, smp_fn_t entry, unsigned long arg);
+int smp_running(unsigned int core);
+int smp_call(unsigned int core, smp_fn_t fn, unsigned long arg);
+void smp_wait(unsigned int core);
+void smp_ipi();
+void smp_ping(unsigned long arg);
+void smp_report();
+
+#endif
@@ -0,0 +1,745 @@
+// The functions in this file provide the locks and queues used to share
+// data between the cores, built on the atomics in atomic.h:
+//
+//   - Ticket spinlocks. A waiting core sleeps with wfe between checks of
+//     the owner ticket. The load-exclusive of the owner ticket arms the
+//     core's exclusive monitor, and the release store of the unlocking
+//     core clears it, which wakes the sleeping core, so no sev is needed.
+//   - Sequence locks, for data read often and written rarely. Readers
+//     never write to shared memory, so they do not slow each other down.
+//   - Bounded single-producer, single-consumer rings, where the producer
+//     only writes the head index and the consumer only the tail index.
+//   - Bounded multi-producer, multi-consumer rings (D. Vyukov's design),
+//     where every cell has a sequence number that says which lap of the
+//     ring may use it next. Producers and consumers claim a position with
+//     a compare-and-swap, and publish the cell with a release store of its
+//     sequence number.
+//
+// sync_stress() runs all of them on every running core at once, and checks
+// the results.
+
+// Header files
+#include "uart.h"
+#include "atomic.h"
+#include "mmu.h"
+#include "smp.h"
+#include "sync.h"
+
+// Stress test phases
+#define SYNC_STRESS_LOCK        0
+#define SYNC_STRESS_MPMC        1
+#define SYNC_STRESS_SEQLOCK     2
+#define SYNC_STRESS_SPSC        3
+#define SYNC_STRESS_PHASES      4
+
+// Size of the rings used by the stress test
+#define SYNC_STRESS_RING_SIZE   256
+
+// Stress test global variables
+struct spinlock syncStressLock;
+unsigned long syncStressLocked;
+volatile unsigned int syncStressAtomic;
+
+struct mpmc_ring syncStressMpmc;
+struct mpmc_cell syncStressMpmcCells[SYNC_STRESS_RING_SIZE];
+volatile unsigned long syncStressPushed;
+volatile unsigned long syncStressPopped;
+volatile unsigned long syncStressPushedSum;
+volatile unsigned long syncStressPoppedSum;
+
+struct seqlock syncStressSeqlock;
+volatile unsigned long syncStressSeqA;
+volatile unsigned long syncStressSeqB;
+volatile unsigned int syncStressWriting;
+volatile unsigned int syncStressTorn;
+volatile unsigned int syncStressReads;
+
+struct spsc_ring syncStressSpsc;
+volatile unsigned long syncStressSpscSlots[SYNC_STRESS_RING_SIZE];
+unsigned int syncStressOutOfOrder;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spin_init
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spin_init(struct spinlock *lock)
+{
+    lock->next = 0;
+    lock->owner = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spin_lock
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        void
+//
+//  Description:    This function takes a ticket, and waits until it is the
+//                  owner of the lock. The first wfe does not sleep, since
+//                  sevl sets the event register.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spin_lock(struct spinlock *lock)
+{
+    unsigned int ticket = atomic_fetch_add(&lock->next, 1);
+    unsigned int owner;
+
+    asm volatile("      sevl\n"
+                 "1:    wfe\n"
+                 "      ldaxr   %w0, [%1]\n"
+                 "      cmp     %w0, %w2\n"
+                 "      b.ne    1b\n"
+                 : "=&r" (owner) : "r" (&lock->owner), "r" (ticket)
+                 : "memory", "cc");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spin_trylock
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        TRUE (non-zero) if the lock was taken, FALSE (zero) if it
+//                  is held or another core is waiting for it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int spin_trylock(struct spinlock *lock)
+{
+    unsigned int owner = atomic_load_acquire(&lock->owner);
+
+    return atomic_compare_exchange(&lock->next, owner, owner + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spin_unlock
+//
+//  Arguments:      lock:     The lock, which this core holds
+//
+//  Returns:        void
+//
+//  Description:    This function passes the lock to the next ticket. Only
+//                  the holder writes the owner ticket.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spin_unlock(struct spinlock *lock)
+{
+    atomic_store_release(&lock->owner, lock->owner + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       seq_init
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void seq_init(struct seqlock *lock)
+{
+    lock->sequence = 0;
+    spin_init(&lock->writer);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       seq_write_begin
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        void
+//
+//  Description:    This function is called before the protected data is
+//                  changed. The odd sequence number is made visible before
+//                  any of the changes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void seq_write_begin(struct seqlock *lock)
+{
+    spin_lock(&lock->writer);
+    lock->sequence = lock->sequence + 1;
+    asm volatile("dmb ishst" : : : "memory");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       seq_write_end
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        void
+//
+//  Description:    This function is called after the protected data is
+//                  changed. The even sequence number is only made visible
+//                  after all of the changes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void seq_write_end(struct seqlock *lock)
+{
+    atomic_store_release(&lock->sequence, lock->sequence + 1);
+    spin_unlock(&lock->writer);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       seq_read_begin
+//
+//  Arguments:      lock:     The lock
+//
+//  Returns:        The sequence number to pass to seq_read_retry().
+//
+//  Description:    This function is called before the protected data is
+//                  read. It waits while a writer is changing the data.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int seq_read_begin(struct seqlock *lock)
+{
+    unsigned int sequence;
+
+    do {
+        sequence = atomic_load_acquire(&lock->sequence);
+    } while (sequence & 1);
+
+    return sequence;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       seq_read_retry
+//
+//  Arguments:      lock:         The lock
+//                  sequence:     The number returned by seq_read_begin()
+//
+//  Returns:        TRUE (non-zero) if the data changed while it was read,
+//                  and must be read again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int seq_read_retry(struct seqlock *lock, unsigned int sequence)
+{
+    asm volatile("dmb ishld" : : : "memory");
+    return lock->sequence != sequence;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spsc_init
+//
+//  Arguments:      ring:      The ring
+//                  slots:     The slots of the ring
+//                  size:      The number of slots (a power of 2)
+//
+//  Returns:        void
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void spsc_init(struct spsc_ring *ring, volatile unsigned long *slots, unsigned int size)
+{
+    ring->slots = slots;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spsc_push
+//
+//  Arguments:      ring:      The ring
+//                  value:     The value to add
+//
+//  Returns:        TRUE (non-zero) if the value was added, FALSE (zero) if
+//                  the ring is full.
+//
+//  Description:    This function must only be called by the producer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int spsc_push(struct spsc_ring *ring, unsigned long value)
+{
+    unsigned int head = ring->head;
+
+    if (head - atomic_load_acquire(&ring->tail) > ring->mask) {
+        return 0;
+    }
+
+    ring->slots[head & ring->mask] = value;
+    atomic_store_release(&ring->head, head + 1);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       spsc_pop
+//
+//  Arguments:      ring:      The ring
+//                  value:     Where to copy the oldest value
+//
+//  Returns:        TRUE (non-zero) if a value was removed, FALSE (zero) if
+//                  the ring is empty.
+//
+//  Description:    This function must only be called by the consumer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int spsc_pop(struct spsc_ring *ring, unsigned long *value)
+{
+    unsigned int tail = ring->tail;
+
+    if (tail == atomic_load_acquire(&ring->head)) {
+        return 0;
+    }
+
+    *value = ring->slots[tail & ring->mask];
+    atomic_store_release(&ring->tail, tail + 1);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mpmc_init
+//
+//  Arguments:      ring:      The ring
+//                  cells:     The cells of the ring
+//                  size:      The number of cells (a power of 2)
+//
+//  Returns:        void
+//
+//  Description:    Cell i is ready to be written at position i.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mpmc_init(struct mpmc_ring *ring, struct mpmc_cell *cells, unsigned int size)
+{
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        cells[i].sequence = i;
+    }
+    ring->cells = cells;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mpmc_push
+//
+//  Arguments:      ring:      The ring
+//                  value:     The value to add
+//
+//  Returns:        TRUE (non-zero) if the value was added, FALSE (zero) if
+//                  the ring is full.
+//
+//  Description:    A cell can be written at a position when its sequence
+//                  number equals the position. If it is smaller, the cell
+//                  has not been read yet in the last lap, and the ring is
+//                  full. If it is larger, another producer took the
+//                  position, and the head is read again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int mpmc_push(struct mpmc_ring *ring, unsigned long value)
+{
+    unsigned int position = ring->head;
+    struct mpmc_cell *cell;
+    int difference;
+
+    while (1) {
+        cell = &ring->cells[position & ring->mask];
+        difference = (int)(atomic_load_acquire(&cell->sequence) - position);
+
+        if (difference == 0) {
+            if (atomic_compare_exchange(&ring->head, position, position + 1)) {
+                break;
+            }
+            position = ring->head;
+        } else if (difference < 0) {
+            return 0;
+        } else {
+            position = ring->head;
+        }
+    }
+
+    cell->value = value;
+    atomic_store_release(&cell->sequence, position + 1);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mpmc_pop
+//
+//  Arguments:      ring:      The ring
+//                  value:     Where to copy the oldest value
+//
+//  Returns:        TRUE (non-zero) if a value was removed, FALSE (zero) if
+//                  the ring is empty.
+//
+//  Description:    A cell can be read at a position when its sequence
+//                  number is one more than the position. Once it is read,
+//                  the sequence number is set to the position of the cell
+//                  in the next lap.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int mpmc_pop(struct mpmc_ring *ring, unsigned long *value)
+{
+    unsigned int position = ring->tail;
+    struct mpmc_cell *cell;
+    int difference;
+
+    while (1) {
+        cell = &ring->cells[position & ring->mask];
+        difference = (int)(atomic_load_acquire(&cell->sequence) - (position + 1));
+
+        if (difference == 0) {
+            if (atomic_compare_exchange(&ring->tail, position, position + 1)) {
+                break;
+            }
+            position = ring->tail;
+        } else if (difference < 0) {
+            return 0;
+        } else {
+            position = ring->tail;
+        }
+    }
+
+    *value = cell->value;
+    atomic_store_release(&cell->sequence, position + ring->mask + 1);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sync_stress_worker
+//
+//  Arguments:      phase:     The stress test phase
+//
+//  Returns:        void
+//
+//  Description:    This function runs one phase of the stress test on the
+//                  current core. It is run on every core at the same time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void sync_stress_worker(unsigned long phase)
+{
+    unsigned long core = smp_core();
+    unsigned long value, pushed = 0, popped = 0, pushedSum = 0, poppedSum = 0;
+    unsigned long a, b;
+    unsigned int i, sequence, torn = 0, reads = 0;
+
+    switch (phase) {
+    case SYNC_STRESS_LOCK:
+        // A plain counter under the lock, and an atomic counter
+        for (i = 0; i < SYNC_STRESS_COUNT; i++) {
+            spin_lock(&syncStressLock);
+            syncStressLocked++;
+            spin_unlock(&syncStressLock);
+            atomic_fetch_add(&syncStressAtomic, 1);
+        }
+        break;
+
+    case SYNC_STRESS_MPMC:
+        // Every core pushes its own values, and pops whatever it finds.
+        // When the ring is full, the core pops a value before trying again.
+        for (i = 0; i < SYNC_STRESS_COUNT; i++) {
+            value = (core << 32) | i;
+            while (!mpmc_push(&syncStressMpmc, value)) {
+                if (mpmc_pop(&syncStressMpmc, &b)) {
+                    popped++;
+                    poppedSum += b;
+                }
+            }
+            pushed++;
+            pushedSum += value;
+
+            if (mpmc_pop(&syncStressMpmc, &b)) {
+                popped++;
+                poppedSum += b;
+            }
+        }
+        atomic_fetch_add64(&syncStressPushed, pushed);
+        atomic_fetch_add64(&syncStressPopped, popped);
+        atomic_fetch_add64(&syncStressPushedSum, pushedSum);
+        atomic_fetch_add64(&syncStressPoppedSum, poppedSum);
+        break;
+
+    case SYNC_STRESS_SEQLOCK:
+        // Core 0 writes pairs that always add up to 0, and the other cores
+        // read them until the writer is done. A torn read is a failure.
+        if (core == 0) {
+            for (i = 1; i <= SYNC_STRESS_COUNT; i++) {
+                seq_write_begin(&syncStressSeqlock);
+                syncStressSeqA = i;
+                syncStressSeqB = -(unsigned long)i;
+                seq_write_end(&syncStressSeqlock);
+            }
+            atomic_store_release(&syncStressWriting, 0);
+        } else {
+            while (atomic_load_acquire(&syncStressWriting)) {
+                do {
+                    sequence = seq_read_begin(&syncStressSeqlock);
+                    a = syncStressSeqA;
+                    b = syncStressSeqB;
+                } while (seq_read_retry(&syncStressSeqlock, sequence));
+                if (a + b != 0) {
+                    torn++;
+                }
+                reads++;
+            }
+            atomic_fetch_add(&syncStressTorn, torn);
+            atomic_fetch_add(&syncStressReads, reads);
+        }
+        break;
+
+    case SYNC_STRESS_SPSC:
+        // Core 1 produces a count, and core 0 checks that it arrives in
+        // order
+        if (core == 1) {
+            for (i = 0; i < SYNC_STRESS_COUNT; i++) {
+                while (!spsc_push(&syncStressSpsc, i)) {
+                    ;
+                }
+            }
+        } else if (core == 0) {
+            for (i = 0; i < SYNC_STRESS_COUNT; i++) {
+                while (!spsc_pop(&syncStressSpsc, &value)) {
+                    ;
+                }
+                if (value != i) {
+                    syncStressOutOfOrder++;
+                }
+            }
+        }
+        break;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sync_stress_phase
+//
+//  Arguments:      phase:     The stress test phase
+//
+//  Returns:        The number of cores that ran the phase.
+//
+//  Description:    This function sends the phase to every other running
+//                  core with smp_call(), runs it on this core, and waits
+//                  for the other cores to finish.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int sync_stress_phase(unsigned long phase)
+{
+    unsigned int core, cores = 1;
+
+    for (core = 1; core < SMP_CORES; core++) {
+        if (smp_call(core, sync_stress_worker, phase) == 0) {
+            cores++;
+        }
+    }
+
+    sync_stress_worker(phase);
+
+    for (core = 1; core < SMP_CORES; core++) {
+        smp_wait(core);
+    }
+
+    return cores;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sync_stress_puthex
+//
+//  Arguments:      value:     A 64-bit value
+//
+//  Returns:        void
+//
+//  Description:    uart_puthex() only writes 32 bits, so a value with any of
+//                  its top 32 bits set is written as its high half followed
+//                  by its low half.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void sync_stress_puthex(unsigned long value)
+{
+    if (value >> 32) {
+        uart_puthex((unsigned int)(value >> 32));
+    }
+    uart_puthex((unsigned int)value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sync_stress_print
+//
+//  Arguments:      name:        The name of the value
+//                  value:       The value found
+//                  expected:    The value it should have
+//
+//  Returns:        TRUE (non-zero) if the value is the expected one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int sync_stress_print(char *name, unsigned long value, unsigned long expected)
+{
+    uart_puts("    ");
+    uart_puts(name);
+    uart_puts(":  0x");
+    sync_stress_puthex(value);
+    if (value != expected) {
+        uart_puts(" (expected 0x");
+        sync_stress_puthex(expected);
+        uart_puts(")");
+    }
+    uart_puts("\n");
+
+    return value == expected;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sync_stress
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function runs the spinlock, atomic counter, MPMC
+//                  ring, sequence lock, and SPSC ring on all running cores
+//                  at once, and writes a report of the results to the
+//                  console. It must be called by core 0, with the MMU on.
+//                  Each core does SYNC_STRESS_COUNT operations per phase.
+//                  The secondary cores run the phases in their IRQ handler.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sync_stress()
+{
+    unsigned long value;
+    unsigned int cores;
+    int passed = 1;
+
+    uart_puts("\nSync stress report:\n");
+    if (!mmu_enabled()) {
+        uart_puts("    the MMU is off, so the atomics do not work\n");
+        return;
+    }
+    if (!smp_running(1)) {
+        uart_puts("    only one core is running\n");
+    }
+
+    // Locks and atomic counters
+    spin_init(&syncStressLock);
+    syncStressLocked = 0;
+    syncStressAtomic = 0;
+    cores = sync_stress_phase(SYNC_STRESS_LOCK);
+    uart_puts("    cores:  0x");
+    uart_puthex(cores);
+    uart_puts("\n");
+    passed &= sync_stress_print("spinlock count", syncStressLocked,
+                                (unsigned long)cores * SYNC_STRESS_COUNT);
+    passed &= sync_stress_print("atomic count", syncStressAtomic,
+                                (unsigned long)cores * SYNC_STRESS_COUNT);
+
+    // MPMC ring. The values left in the ring are popped at the end.
+    mpmc_init(&syncStressMpmc, syncStressMpmcCells, SYNC_STRESS_RING_SIZE);
+    syncStressPushed = 0;
+    syncStressPopped = 0;
+    syncStressPushedSum = 0;
+    syncStressPoppedSum = 0;
+    sync_stress_phase(SYNC_STRESS_MPMC);
+    while (mpmc_pop(&syncStressMpmc, &value)) {
+        syncStressPopped++;
+        syncStressPoppedSum += value;
+    }
+    passed &= sync_stress_print("MPMC popped", syncStressPopped, syncStressPushed);
+    passed &= sync_stress_print("MPMC sum", syncStressPoppedSum, syncStressPushedSum);
+
+    // Sequence lock
+    seq_init(&syncStressSeqlock);
+    syncStressSeqA = 0;
+    syncStressSeqB = 0;
+    syncStressTorn = 0;
+    syncStressReads = 0;
+    syncStressWriting = 1;
+    sync_stress_phase(SYNC_STRESS_SEQLOCK);
+    uart_puts("    seqlock reads:  0x");
+    uart_puthex(syncStressReads);
+    uart_puts("\n");
+    passed &= sync_stress_print("seqlock torn reads", syncStressTorn, 0);
+
+    // SPSC ring, which needs core 1 as the producer
+    if (smp_running(1)) {
+        spsc_init(&syncStressSpsc, syncStressSpscSlots, SYNC_STRESS_RING_SIZE);
+        syncStressOutOfOrder = 0;
+        sync_stress_phase(SYNC_STRESS_SPSC);
+        passed &= sync_stress_print("SPSC out of order", syncStressOutOfOrder, 0);
+    }
+
+    uart_puts(passed ? "    result:  passed\n" : "    result:  FAILED\n");
+}
@@ -0,0 +1,74 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+// Definitions and function prototypes for the locks and queues in sync.c,
+// which are built on the atomics in atomic.h
+
+// Number of operations done by each core in sync_stress()
+#define SYNC_STRESS_COUNT       100000
+
+// A ticket spinlock. A core takes the next ticket, and waits until the
+// owner ticket reaches it, so the lock is taken in the order asked for.
+struct spinlock {
+    volatile unsigned int next;
+    volatile unsigned int owner;
+};
+
+// A sequence lock, for data read much more often than it is written. The
+// sequence number is odd while a writer is changing the data, and readers
+// retry if it was odd or changed while they read. Writers are serialized
+// with a spinlock.
+struct seqlock {
+    volatile unsigned int sequence;
+    struct spinlock writer;
+};
+
+// A bounded single-producer, single-consumer ring of 64-bit values. The
+// slots are given by the caller, and their number must be a power of 2.
+struct spsc_ring {
+    volatile unsigned long *slots;
+    unsigned int mask;
+    volatile unsigned int head __attribute__((aligned(64)));
+    volatile unsigned int tail __attribute__((aligned(64)));
+};
+
+// A cell of a multi-producer, multi-consumer ring. The sequence number
+// says whether the cell is ready to be written or read, and in which lap
+// of the ring.
+struct mpmc_cell {
+    volatile unsigned int sequence;
+    unsigned long value;
+};
+
+// A bounded multi-producer, multi-consumer ring of 64-bit values. The
+// cells are given by the caller, and their number must be a power of 2.
+struct mpmc_ring {
+    struct mpmc_cell *cells;
+    unsigned int mask;
+    volatile unsigned int head __attribute__((aligned(64)));
+    volatile unsigned int tail __attribute__((aligned(64)));
+};
+
+// Function prototypes
+void spin_init(struct spinlock *lock);
+void spin_lock(struct spinlock *lock);
+int spin_trylock(struct spinlock *lock);
+void spin_unlock(struct spinlock *lock);
+
+void seq_init(struct seqlock *lock);
+void seq_write_begin(struct seqlock *lock);
+void seq_write_end(struct seqlock *lock);
+unsigned int seq_read_begin(struct seqlock *lock);
+int seq_read_retry(struct seqlock *lock, unsigned int sequence);
+
+void spsc_init(struct spsc_ring *ring, volatile unsigned long *slots, unsigned int size);
+int spsc_push(struct spsc_ring *ring, unsigned long value);
+int spsc_pop(struct spsc_ring *ring, unsigned long *value);
+
+void mpmc_init(struct mpmc_ring *ring, struct mpmc_cell *cells, unsigned int size);
+int mpmc_push(struct mpmc_ring *ring, unsigned long value);
+int mpmc_pop(struct mpmc_ring *ring, unsigned long *value);
+
+void sync_stress();
+
+#endif
@@ -0,0 +1,455 @@
+// The functions in this file run tasks on all the cores, balancing the load
+// by work stealing.
+//
+// Every core has a Chase-Lev deque of tasks. A core pushes the tasks it
+// spawns onto the bottom of its own deque, and pops them back from the
+// bottom, newest first, so it mostly works on data that is still in its
+// cache. A core that runs out of tasks steals the oldest task from the top
+// of another core's deque. The owner only takes the bottom index and thieves
+// only take the top index, so the two only race for the last task, which is
+// settled with a compare-and-swap on the top index (see task_pop()).
+//
+// The secondary cores run task_worker(), which looks for tasks and sleeps
+// with wfe when there are none. Spawning a task and finishing one both send
+// an event with sev, which wakes them. A core waiting in task_sync() runs
+// tasks (its own, or stolen ones) until the tasks it waits for are done.
+//
+// parallel_for() splits an index range in half again and again, keeping
+// the lower half and spawning the upper half, so the first tasks stolen are
+// the largest ones, and a core that finishes early takes a share of the
+// rest of the range.
+//
+// The runtime needs the MMU to be on (see mmu.c), since it uses the atomics
+// in atomic.h. Tasks must not be spawned or waited for by an interrupt
+// handler, since the handler could interrupt the owner of the deque.
+
+// Header files
+#include "uart.h"
+#include "atomic.h"
+#include "mmu.h"
+#include "smp.h"
+#include "task.h"
+
+// Task global variables: the deque of each core, and the number of tasks
+// each core has run, stolen, and run at once because its deque was full
+struct task_deque taskDeques[SMP_CORES];
+volatile unsigned int taskRun[SMP_CORES];
+volatile unsigned int taskStolen[SMP_CORES];
+volatile unsigned int taskInline[SMP_CORES];
+
+// Function prototypes
+static void task_run(struct task *task);
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_push
+//
+//  Arguments:      deque:     The deque of this core
+//                  task:      The task to add
+//
+//  Returns:        TRUE (non-zero) if the task was added, FALSE (zero) if the
+//                  deque is full.
+//
+//  Description:    This function adds a task to the bottom of the deque. The
+//                  task is written before the bottom index is moved past it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int task_push(struct task_deque *deque, const struct task *task)
+{
+    long bottom = deque->bottom;
+    long top = (long)atomic_load_acquire64((volatile unsigned long *)&deque->top);
+
+    if (bottom - top >= TASK_DEQUE_SIZE) {
+        return 0;
+    }
+
+    deque->tasks[bottom & (TASK_DEQUE_SIZE - 1)] = *task;
+    atomic_store_release64((volatile unsigned long *)&deque->bottom, bottom + 1);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_pop
+//
+//  Arguments:      deque:     The deque of this core
+//                  task:      Where to copy the task taken
+//
+//  Returns:        TRUE (non-zero) if a task was taken, FALSE (zero) if the
+//                  deque is empty.
+//
+//  Description:    This function takes the newest task from the bottom of
+//                  the deque. The bottom index is moved first, and the top
+//                  index read after a full barrier, so a thief either sees
+//                  the task gone or is seen taking it. If it is the last
+//                  task, the owner and the thieves race for it with a
+//                  compare-and-swap on the top index.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int task_pop(struct task_deque *deque, struct task *task)
+{
+    long bottom = deque->bottom - 1;
+    long top;
+    int taken = 1;
+
+    deque->bottom = bottom;
+    atomic_fence();
+    top = deque->top;
+
+    if (top > bottom) {
+        deque->bottom = bottom + 1;
+        return 0;
+    }
+
+    *task = deque->tasks[bottom & (TASK_DEQUE_SIZE - 1)];
+    if (top == bottom) {
+        taken = atomic_compare_exchange64((volatile unsigned long *)&deque->top,
+                                          top, top + 1);
+        deque->bottom = bottom + 1;
+    }
+
+    return taken;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_steal
+//
+//  Arguments:      deque:     The deque of another core
+//                  task:      Where to copy the task taken
+//
+//  Returns:        TRUE (non-zero) if a task was taken, FALSE (zero) if the
+//                  deque is empty, or another core took the task first.
+//
+//  Description:    This function takes the oldest task from the top of the
+//                  deque. The task is copied before the top index is moved
+//                  past it, since the owner may reuse the slot afterwards.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int task_steal(struct task_deque *deque, struct task *task)
+{
+    long top, bottom;
+
+    top = (long)atomic_load_acquire64((volatile unsigned long *)&deque->top);
+    atomic_fence();
+    bottom = (long)atomic_load_acquire64((volatile unsigned long *)&deque->bottom);
+
+    if (top >= bottom) {
+        return 0;
+    }
+
+    *task = deque->tasks[top & (TASK_DEQUE_SIZE - 1)];
+
+    return atomic_compare_exchange64((volatile unsigned long *)&deque->top,
+                                     top, top + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_find
+//
+//  Arguments:      core:     The number of this core
+//                  task:     Where to copy the task found
+//
+//  Returns:        TRUE (non-zero) if a task was found.
+//
+//  Description:    This function takes a task from this core's deque, or
+//                  else steals one from the other cores, starting with the
+//                  next core up so that the thieves spread out.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int task_find(unsigned int core, struct task *task)
+{
+    unsigned int i;
+
+    if (task_pop(&taskDeques[core], task)) {
+        return 1;
+    }
+
+    for (i = 1; i < SMP_CORES; i++) {
+        if (task_steal(&taskDeques[(core + i) & (SMP_CORES - 1)], task)) {
+            taskStolen[core]++;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_submit
+//
+//  Arguments:      task:     The task
+//
+//  Returns:        void
+//
+//  Description:    This function adds a task to its group, and pushes it
+//                  onto this core's deque, waking the idle cores. If the
+//                  deque is full, the task is run at once.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void task_submit(struct task *task)
+{
+    unsigned int core = smp_core();
+
+    atomic_fetch_add(&task->group->pending, 1);
+
+    if (task_push(&taskDeques[core], task)) {
+        asm volatile("dsb ish\n"
+                     "sev" : : : "memory");
+    } else {
+        taskInline[core]++;
+        task_run(task);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_run
+//
+//  Arguments:      task:     The task
+//
+//  Returns:        void
+//
+//  Description:    This function runs a task, and removes it from its
+//                  group. Part of a parallel loop is split until it is no
+//                  larger than the grain of the loop, spawning the upper
+//                  halves, and the body is then called for each index left.
+//                  An event is sent once the task is done, to wake a core
+//                  waiting in task_sync().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void task_run(struct task *task)
+{
+    struct task_range *range = task->range;
+    struct task half;
+    unsigned long middle, i;
+
+    if (range) {
+        while (task->end - task->begin > range->grain) {
+            middle = task->begin + (task->end - task->begin) / 2;
+            half = *task;
+            half.begin = middle;
+            task_submit(&half);
+            task->end = middle;
+        }
+
+        for (i = task->begin; i < task->end; i++) {
+            range->body(i, range->arg);
+        }
+    } else {
+        task->fn(task->arg);
+    }
+
+    taskRun[smp_core()]++;
+
+    atomic_fetch_add(&task->group->pending, -1);
+    asm volatile("dsb ish\n"
+                 "sev" : : : "memory");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_worker
+//
+//  Arguments:      arg:     Not used
+//
+//  Returns:        never
+//
+//  Description:    This function is the entry function of the secondary
+//                  cores (see smp_start()). It runs the tasks it finds, and
+//                  sleeps with wfe while there are none. Calls from
+//                  smp_call() are still run, by the IRQ handler.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void task_worker(unsigned long arg)
+{
+    unsigned int core = smp_core();
+    struct task task;
+
+    while (1) {
+        if (task_find(core, &task)) {
+            task_run(&task);
+        } else {
+            asm volatile("wfe");
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_spawn
+//
+//  Arguments:      group:     The group the task belongs to
+//                  fn:        The function to run
+//                  arg:       The argument passed to the function
+//
+//  Returns:        void
+//
+//  Description:    This function makes a task that may be run by any core.
+//                  Use task_sync() to wait for it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void task_spawn(struct task_group *group, task_fn_t fn, unsigned long arg)
+{
+    struct task task;
+
+    task.fn = fn;
+    task.arg = arg;
+    task.range = 0;
+    task.begin = 0;
+    task.end = 0;
+    task.group = group;
+
+    task_submit(&task);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_sync
+//
+//  Arguments:      group:     The group to wait for
+//
+//  Returns:        void
+//
+//  Description:    This function waits until every task spawned in the group
+//                  has finished. Rather than sit idle, this core runs the
+//                  tasks it can find in the meantime.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void task_sync(struct task_group *group)
+{
+    unsigned int core = smp_core();
+    struct task task;
+
+    while (atomic_load_acquire(&group->pending)) {
+        if (task_find(core, &task)) {
+            task_run(&task);
+        } else {
+            asm volatile("wfe");
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       parallel_for
+//
+//  Arguments:      begin:     The first index
+//                  end:       One past the last index
+//                  grain:     The largest number of indices not split up
+//                             any further
+//                  body:      The function called for every index
+//                  arg:       The argument passed to the function
+//
+//  Returns:        void
+//
+//  Description:    This function calls the body for every index of the
+//                  range, on as many cores as are free, and returns when all
+//                  the calls have returned. The calls may be made in any
+//                  order, so they must not depend on each other. If the MMU
+//                  is off, the atomics do not work, so this core makes all
+//                  the calls itself.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void parallel_for(unsigned long begin, unsigned long end, unsigned long grain,
+                  task_body_t body, unsigned long arg)
+{
+    struct task_range range;
+    struct task_group group;
+    struct task task;
+    unsigned long i;
+
+    if (begin >= end) {
+        return;
+    }
+
+    if (!mmu_enabled()) {
+        for (i = begin; i < end; i++) {
+            body(i, arg);
+        }
+        return;
+    }
+
+    range.body = body;
+    range.arg = arg;
+    range.grain = grain ? grain : 1;
+
+    group.pending = 1;
+
+    task.fn = 0;
+    task.arg = 0;
+    task.range = &range;
+    task.begin = begin;
+    task.end = end;
+    task.group = &group;
+
+    task_run(&task);
+    task_sync(&group);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       task_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function writes the number of tasks each core has
+//                  run, stolen, and run at once because its deque was full,
+//                  to the console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void task_report()
+{
+    unsigned int core;
+
+    uart_puts("\nTask report:\n");
+    for (core = 0; core < SMP_CORES; core++) {
+        uart_puts("    core ");
+        uart_putc('0' + core);
+        uart_puts(" tasks run:  0x");
+        uart_puthex(taskRun[core]);
+        uart_puts(", stolen:  0x");
+        uart_puthex(taskStolen[core]);
+        uart_puts(", run at once:  0x");
+        uart_puthex(taskInline[core]);
+        uart_puts("\n");
+    }
+}
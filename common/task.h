@@ -0,0 +1,56 @@
+#ifndef TASK_H
+#define TASK_H
+
+// Definitions and function prototypes for the work-stealing task runtime in
+// task.c
+
+// Number of tasks each core's deque can hold (must be a power of 2). A task
+// spawned while the deque is full is run at once instead.
+#define TASK_DEQUE_SIZE         256
+
+// A spawned task, and the body of a parallel loop, which is called once for
+// every index of the range
+typedef void (*task_fn_t)(unsigned long arg);
+typedef void (*task_body_t)(unsigned long index, unsigned long arg);
+
+// A group of spawned tasks. task_sync() waits until all the tasks spawned in
+// the group have finished. It must start out as 0.
+struct task_group {
+    volatile unsigned int pending;
+};
+
+// A parallel loop, shared by all the tasks that run parts of its range
+struct task_range {
+    task_body_t body;
+    unsigned long arg;
+    unsigned long grain;
+};
+
+// A task: either a function and its argument, or part of a parallel loop
+struct task {
+    task_fn_t fn;
+    unsigned long arg;
+    struct task_range *range;
+    unsigned long begin;
+    unsigned long end;
+    struct task_group *group;
+};
+
+// A Chase-Lev deque. The owning core pushes and pops tasks at the bottom,
+// and other cores steal them from the top. The indices only ever grow, and
+// are kept on separate cache lines.
+struct task_deque {
+    volatile long top __attribute__((aligned(64)));
+    volatile long bottom __attribute__((aligned(64)));
+    struct task tasks[TASK_DEQUE_SIZE];
+};
+
+// Function prototypes
+void task_worker(unsigned long arg);
+void task_spawn(struct task_group *group, task_fn_t fn, unsigned long arg);
+void task_sync(struct task_group *group);
+void parallel_for(unsigned long begin, unsigned long end, unsigned long grain,
+                  task_body_t body, unsigned long arg);
+void task_report();
+
+#endif
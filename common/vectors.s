@@ -0,0 +1,179 @@
+// This file contains the exception vector table and the exception handler
+// stubs used by both kernels. It is found by the Makefiles through vpath,
+// so there is only one copy of it.
+//
+// The table has all 16 entries: synchronous, IRQ, FIQ, and SError
+// exceptions, for each of the four places an exception can come from (the
+// current EL using SP_EL0, the current EL using SP_ELx, a lower EL in
+// AArch64, and a lower EL in AArch32). Every exception taken to EL1 now
+// lands in a handler, whichever stack pointer was in use.
+//
+//   - IRQs go to a fast stub that saves only the registers C code may
+//     change, and calls IRQ_handler() (in the kernel's handlers.c).
+//   - FIQs go straight to FIQ_handler, which the kernel may provide in
+//     assembly. By default it just returns.
+//   - Synchronous exceptions and SErrors go to a stub that saves the same
+//     registers, and calls exception_handler() (in exceptions.c), which
+//     reports ESR_EL1 and FAR_EL1 on the console.
+//
+// The start routine sets VBAR_EL1 to _vectors.
+//
+// Both stubs save a frame of 192 bytes: x0 to x18 (at offsets 0 to 144),
+// x29, x30, ELR_EL1, and SPSR_EL1. Its layout is given by the FRAME_*
+// constants in exceptions.h.
+
+
+	.text
+
+	// Save the registers of the interrupted code in a new frame on the
+	// stack. The frame is allocated with a single SP update, keeping SP
+	// 16-byte aligned, and filled with paired stores. The callee-saved
+	// registers x19-x28 are not saved, since any C function that uses them
+	// saves and restores them itself. x29 is saved so that the sampling
+	// profiler can follow the frame pointer chain of the interrupted code.
+	// ELR_EL1 and SPSR_EL1 are saved so that the handler can unmask
+	// exceptions again.
+	.macro	save_frame
+	sub	sp, sp, 192
+	stp	x0, x1, [sp, 0]
+	stp	x2, x3, [sp, 16]
+	stp	x4, x5, [sp, 32]
+	stp	x6, x7, [sp, 48]
+	stp	x8, x9, [sp, 64]
+	stp	x10, x11, [sp, 80]
+	stp	x12, x13, [sp, 96]
+	stp	x14, x15, [sp, 112]
+	stp	x16, x17, [sp, 128]
+	stp	x18, x29, [sp, 144]
+	mrs	x0, elr_el1
+	stp	x30, x0, [sp, 160]
+	mrs	x1, spsr_el1
+	str	x1, [sp, 176]
+	.endm
+
+	// Restore the registers saved by save_frame, free the frame, and
+	// return from the exception
+	.macro	restore_frame
+	ldp	x30, x0, [sp, 160]
+	ldr	x1, [sp, 176]
+	msr	elr_el1, x0
+	msr	spsr_el1, x1
+	ldp	x0, x1, [sp, 0]
+	ldp	x2, x3, [sp, 16]
+	ldp	x4, x5, [sp, 32]
+	ldp	x6, x7, [sp, 48]
+	ldp	x8, x9, [sp, 64]
+	ldp	x10, x11, [sp, 80]
+	ldp	x12, x13, [sp, 96]
+	ldp	x14, x15, [sp, 112]
+	ldp	x16, x17, [sp, 128]
+	ldp	x18, x29, [sp, 144]
+	add	sp, sp, 192
+	eret
+	.endm
+
+
+	// The IRQ stub
+_IRQ_stub:
+	save_frame
+
+	// Unmask FIQs while the IRQ is handled, so that the FIQ never waits
+	// for the interrupt handlers. This is safe now that ELR_EL1 and
+	// SPSR_EL1 are saved, since a FIQ overwrites them.
+	msr	DAIFClr, 0b0001
+
+	// Call the IRQ handler written in C, passing it the address of
+	// the frame
+	mov	x0, sp
+	bl	IRQ_handler
+
+	// Mask FIQs again before ELR_EL1 and SPSR_EL1 are restored
+	msr	DAIFSet, 0b0001
+	restore_frame
+
+
+	// The stub for all other exceptions. The vector has already saved x0
+	// and x1 at the top of the frame, and put the number of the vector
+	// (0 to 15) in x1.
+_exception_stub:
+	stp	x2, x3, [sp, 16]
+	stp	x4, x5, [sp, 32]
+	stp	x6, x7, [sp, 48]
+	stp	x8, x9, [sp, 64]
+	stp	x10, x11, [sp, 80]
+	stp	x12, x13, [sp, 96]
+	stp	x14, x15, [sp, 112]
+	stp	x16, x17, [sp, 128]
+	stp	x18, x29, [sp, 144]
+	mrs	x0, elr_el1
+	stp	x30, x0, [sp, 160]
+	mrs	x0, spsr_el1
+	str	x0, [sp, 176]
+
+	// Call the exception handler written in C, passing it the address of
+	// the frame and the number of the vector. It only returns if the
+	// exception can be resumed.
+	mov	x0, sp
+	bl	exception_handler
+	restore_frame
+
+
+	// The default FIQ handler, used if the kernel does not provide one.
+	// No interrupt is routed to the FIQ, so there is nothing to do.
+	.weak	FIQ_handler
+FIQ_handler:
+	eret
+
+
+
+	// A vector that passes the exception to _exception_stub, with the
+	// number of the vector in x1
+	.macro	exception_vector number
+	.align	7
+	sub	sp, sp, 192
+	stp	x0, x1, [sp, 0]
+	mov	x1, \number
+	b	_exception_stub
+	.endm
+
+	// A vector that branches to a handler
+	.macro	branch_vector handler
+	.align	7
+	b	\handler
+	.endm
+
+
+	// Exception Vector Table:
+	//
+	// The start of the table must be aligned to an address
+	// evenly divisible by 2048 (i.e. it must end with 11 zeroes).
+	// Furthermore, each entry must also be aligned to an
+	// address evenly divisible by 128 (i.e. must end with 7 zeroes),
+	// and entries must follow each other consecutively in memory.
+	// Each vector can be as long as 32 instructions.
+	.align	11
+	.global	_vectors
+_vectors:
+	// Current EL with SP_EL0
+	exception_vector 0		// Synchronous
+	branch_vector _IRQ_stub		// IRQ
+	branch_vector FIQ_handler	// FIQ
+	exception_vector 3		// SError
+
+	// Current EL with SP_ELx
+	exception_vector 4		// Synchronous
+	branch_vector _IRQ_stub		// IRQ
+	branch_vector FIQ_handler	// FIQ
+	exception_vector 7		// SError
+
+	// Lower EL using AArch64
+	exception_vector 8		// Synchronous
+	branch_vector _IRQ_stub		// IRQ
+	branch_vector FIQ_handler	// FIQ
+	exception_vector 11		// SError
+
+	// Lower EL using AArch32 (never used by these kernels)
+	exception_vector 12		// Synchronous
+	exception_vector 13		// IRQ
+	exception_vector 14		// FIQ
+	exception_vector 15		// SError
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#  This script symbolizes the call-graph table written to the console by
+#  profile_dump() in a kernel built with 'make PROFILE=1'.
+#
+#  Capture the console output into a file (for example with
+#  'make run | tee console.log', or minicom's capture feature), type 'p' on
+#  the console to dump the profile, and then run:
+#
+#      tools/profsym.py console.log Assignment4/kernel8.elf
+#
+#  The symbol file can be the kernel8.elf file (read with nm), or the
+#  kernel8.dump file created by the Makefile (parsed directly). If the log
+#  contains several dumps, the last one is used.
+
+import os
+import re
+import subprocess
+import sys
+from bisect import bisect_right
+
+
+# The nm program used to read symbols from kernel8.elf. Override it with
+# the NM environment variable if the toolchain is installed elsewhere.
+DEFAULT_NM = "/usr/local/linaro/gcc-linaro-7.3.1-2018.05-x86_64_aarch64-elf/bin/aarch64-elf-nm"
+
+
+def load_symbols(path):
+    """Return a sorted list of (address, name) for the text symbols."""
+    symbols = []
+    if path.endswith(".dump"):
+        # objdump -d prints a line such as "0000000000080800 <main>:"
+        label = re.compile(r"^([0-9a-fA-F]+) <([^>]+)>:")
+        with open(path) as f:
+            for line in f:
+                m = label.match(line)
+                if m:
+                    symbols.append((int(m.group(1), 16), m.group(2)))
+    else:
+        nm = os.environ.get("NM", DEFAULT_NM)
+        if not os.path.exists(nm):
+            nm = "aarch64-elf-nm"
+        out = subprocess.run([nm, "-n", path], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True)
+        for line in out.stdout.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in "tTwW":
+                symbols.append((int(fields[0], 16), fields[2]))
+    symbols.sort()
+    return symbols
+
+
+class Symbolizer:
+    def __init__(self, symbols):
+        self.addresses = [a for a, _ in symbols]
+        self.names = [n for _, n in symbols]
+
+    def name(self, address):
+        i = bisect_right(self.addresses, address) - 1
+        if i < 0:
+            return "0x%x" % address
+        return self.names[i]
+
+
+def read_dump(path):
+    """Return (total cycles, header counters, rows) of the last dump."""
+    dump = None
+    last = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            fields = line.split()
+            if line.startswith("PROFILE BEGIN"):
+                dump = (int(fields[2], 16), fields[3:], [])
+            elif line.startswith("PROFILE END"):
+                if dump is not None:
+                    last = dump
+            elif dump is not None and len(fields) == 5:
+                try:
+                    dump[2].append([int(x, 16) for x in fields])
+                except ValueError:
+                    pass
+    if last is None:
+        sys.exit("no complete PROFILE BEGIN/END block found in " + path)
+    return last
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: profsym.py console.log kernel8.elf|kernel8.dump")
+
+    total, counters, rows = read_dump(sys.argv[1])
+    sym = Symbolizer(load_symbols(sys.argv[2]))
+
+    # Fold the caller/callee pairs into per-function totals
+    flat = {}
+    edges = {}
+    for caller, callee, calls, inclusive, self_cycles in rows:
+        src, dst = sym.name(caller), sym.name(callee)
+        f = flat.setdefault(dst, [0, 0, 0])
+        f[0] += calls
+        f[1] += inclusive
+        f[2] += self_cycles
+        e = edges.setdefault((src, dst), [0, 0])
+        e[0] += calls
+        e[1] += inclusive
+
+    print("total cycles: %d   table full: %d   stack overflow: %d"
+          % (total, int(counters[0], 16), int(counters[1], 16)))
+    print()
+    print("%6s %16s %16s %12s  %s" % ("self%", "self", "inclusive", "calls", "function"))
+    for name, (calls, inclusive, self_cycles) in sorted(
+            flat.items(), key=lambda kv: kv[1][2], reverse=True):
+        pct = 100.0 * self_cycles / total if total else 0.0
+        print("%6.2f %16d %16d %12d  %s" % (pct, self_cycles, inclusive, calls, name))
+
+    print()
+    print("%16s %12s  %s" % ("inclusive", "calls", "caller -> callee"))
+    for (src, dst), (calls, inclusive) in sorted(
+            edges.items(), key=lambda kv: kv[1][1], reverse=True):
+        print("%16d %12d  %s -> %s" % (inclusive, calls, src, dst))
+
+
+if __name__ == "__main__":
+    main()
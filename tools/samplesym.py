@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+#  This script symbolizes the PC histogram and call chains written to the
+#  console by sample_export() (type 's' on the console of the Assignment4
+#  kernel). It prints a flat profile, and can also write the call chains
+#  in the "folded" format read by flamegraph.pl:
+#
+#      tools/samplesym.py console.log Assignment4/kernel8.elf
+#      tools/samplesym.py console.log Assignment4/kernel8.elf --folded out.folded
+#      flamegraph.pl out.folded > profile.svg
+#
+#  The symbol file can be kernel8.elf or kernel8.dump, as for profsym.py.
+#  If the log contains several exports, the last one is used.
+
+import argparse
+import sys
+
+from profsym import Symbolizer, load_symbols
+
+
+def read_export(path):
+    """Return (header, histogram, chains) of the last export in the log."""
+    export = None
+    last = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            fields = line.split()
+            try:
+                if line.startswith("SAMPLES BEGIN"):
+                    export = ([int(x, 16) for x in fields[2:5]], {}, [])
+                elif line.startswith("SAMPLES END"):
+                    if export is not None:
+                        last = export
+                elif export is not None and fields and fields[0] == "H":
+                    export[1][int(fields[1], 16)] = int(fields[2], 16)
+                elif export is not None and fields and fields[0] == "S":
+                    export[2].append([int(x, 16) for x in fields[1:]])
+            except (ValueError, IndexError):
+                pass
+    if last is None:
+        sys.exit("no complete SAMPLES BEGIN/END block found in " + path)
+    return last
+
+
+def chain_names(sym, chain):
+    """Return the function names of a call chain, outermost caller first.
+
+    Entry 0 is the sampled PC. The others are return addresses, which point
+    just after the call instruction, so 4 is subtracted before the lookup.
+    The link register duplicates the first frame record whenever the
+    sampled function has already saved it, so repeated names are dropped.
+    """
+    names = []
+    for i, address in enumerate(chain):
+        name = sym.name(address if i == 0 else address - 4)
+        if not names or names[-1] != name:
+            names.append(name)
+    return list(reversed(names))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("log")
+    parser.add_argument("symbols", help="kernel8.elf or kernel8.dump")
+    parser.add_argument("--folded", help="write folded call chains to this file")
+    parser.add_argument("--top", type=int, default=20,
+                        help="number of hottest addresses to list")
+    args = parser.parse_args()
+
+    (interval, total, out_of_range), histogram, chains = read_export(args.log)
+    sym = Symbolizer(load_symbols(args.symbols))
+
+    flat = {}
+    for address, count in histogram.items():
+        name = sym.name(address)
+        flat[name] = flat.get(name, 0) + count
+
+    print("samples: %d   interval: %d us   outside the program: %d"
+          % (total, interval, out_of_range))
+    print()
+    print("%7s %10s  %s" % ("%", "samples", "function"))
+    for name, count in sorted(flat.items(), key=lambda kv: kv[1], reverse=True):
+        print("%7.2f %10d  %s" % (100.0 * count / total if total else 0.0,
+                                   count, name))
+
+    print()
+    print("%10s %10s  %s" % ("address", "samples", "function"))
+    hottest = sorted(histogram.items(), key=lambda kv: kv[1], reverse=True)
+    for address, count in hottest[:args.top]:
+        print("%10x %10d  %s" % (address, count, sym.name(address)))
+
+    if args.folded:
+        folded = {}
+        for chain in chains:
+            key = ";".join(chain_names(sym, chain))
+            folded[key] = folded.get(key, 0) + 1
+        with open(args.folded, "w") as f:
+            for key, count in sorted(folded.items()):
+                f.write("%s %d\n" % (key, count))
+
+
+if __name__ == "__main__":
+    main()